@@ -39,6 +39,7 @@
 #include "goal_internal.h"
 #include "iutil.h"
 #include "package_internal.h"
+#include "packagelist_internal.h"
 #include "packageset.h"
 #include "query_internal.h"
 #include "reldep_internal.h"
@@ -337,7 +338,7 @@ list_results(HyGoal goal, Id type_filter1, Id type_filter2)
 	}
 
 	if (type == type_filter1 || (type_filter2 && type == type_filter2))
-	    hy_packagelist_push(plist, package_create(goal->sack, p));
+	    packagelist_push_id(plist, goal->sack, p);
     }
     return plist;
 }
@@ -997,6 +998,155 @@ hy_goal_list_obsoleted_by_package(HyGoal goal, HyPackage pkg)
     return plist;
 }
 
+#define NRESULT_LISTS (HY_RESULT_DOWNGRADES + 1)
+
+struct _HyGoalResults {
+    HySack sack;
+    HyPackageList lists[NRESULT_LISTS];
+    Queue obsoleters;		/* triples: package, offset and count */
+    Queue obsoleted;		/* what the triples point into */
+};
+
+static int
+result_list(Id type)
+{
+    switch (type) {
+    case SOLVER_TRANSACTION_ERASE:
+	return HY_RESULT_ERASURES;
+    case SOLVER_TRANSACTION_INSTALL:
+    case SOLVER_TRANSACTION_OBSOLETES:
+	return HY_RESULT_INSTALLS;
+    case SOLVER_TRANSACTION_REINSTALL:
+	return HY_RESULT_REINSTALLS;
+    case SOLVER_TRANSACTION_UPGRADE:
+	return HY_RESULT_UPGRADES;
+    case SOLVER_TRANSACTION_DOWNGRADE:
+	return HY_RESULT_DOWNGRADES;
+    default:
+	return -1;
+    }
+}
+
+static int
+obsoleter_cmp(const void *ap, const void *bp, void *dp)
+{
+    return *(const Id *)ap - *(const Id *)bp;
+}
+
+/**
+ * Classify all the steps of the transaction in one go.
+ *
+ * Gives the same lists as the hy_goal_list_*() functions for the
+ * transaction, and remembers what every incoming package obsoletes.
+ *
+ * @returns	NULL and sets hy_errno to HY_E_OP if the goal was not run, or to
+ *		HY_E_NO_SOLUTION if it found no solution.
+ */
+HyGoalResults
+hy_goal_results(HyGoal goal)
+{
+    Transaction *trans = goal->trans;
+
+    if (!trans) {
+	if (!goal->solv)
+	    hy_errno = HY_E_OP;
+	else
+	    hy_errno = HY_E_NO_SOLUTION;
+	return NULL;
+    }
+
+    HySack sack = goal->sack;
+    Pool *pool = sack_pool(sack);
+    HyGoalResults res = solv_calloc(1, sizeof(*res));
+    const int common_mode = SOLVER_TRANSACTION_SHOW_OBSOLETES |
+	SOLVER_TRANSACTION_CHANGE_IS_REINSTALL;
+    Queue obs;
+
+    res->sack = sack;
+    for (int i = 0; i < NRESULT_LISTS; ++i)
+	res->lists[i] = hy_packagelist_create();
+    queue_init(&res->obsoleters);
+    queue_init(&res->obsoleted);
+    queue_init(&obs);
+    for (int i = 0; i < trans->steps.count; ++i) {
+	Id p = trans->steps.elements[i];
+	Id type = transaction_type(trans, p, common_mode |
+				   SOLVER_TRANSACTION_SHOW_ACTIVE |
+				   SOLVER_TRANSACTION_SHOW_ALL);
+	int which = result_list(type);
+
+	if (which >= 0)
+	    packagelist_push_id(res->lists[which], sack, p);
+	if (pool->installed && pool->solvables[p].repo == pool->installed) {
+	    // only the passive view tells what gets obsoleted
+	    if (transaction_type(trans, p, common_mode) ==
+		SOLVER_TRANSACTION_OBSOLETED)
+		packagelist_push_id(res->lists[HY_RESULT_OBSOLETED], sack, p);
+	    continue;
+	}
+	transaction_all_obs_pkgs(trans, p, &obs);
+	if (obs.count == 0)
+	    continue;
+	queue_push2(&res->obsoleters, p, res->obsoleted.count);
+	queue_push(&res->obsoleters, obs.count);
+	for (int j = 0; j < obs.count; ++j)
+	    queue_push(&res->obsoleted, obs.elements[j]);
+    }
+    queue_free(&obs);
+    solv_sort(res->obsoleters.elements, res->obsoleters.count / 3,
+	      3 * sizeof(Id), obsoleter_cmp, NULL);
+    return res;
+}
+
+void
+hy_goal_results_free(HyGoalResults res)
+{
+    for (int i = 0; i < NRESULT_LISTS; ++i)
+	hy_packagelist_free(res->lists[i]);
+    queue_free(&res->obsoleters);
+    queue_free(&res->obsoleted);
+    solv_free(res);
+}
+
+/**
+ * Returns one of the lists in res, HY_RESULT_INSTALLS etc.
+ *
+ * The list is owned by res and valid until it is freed.
+ */
+HyPackageList
+hy_goal_results_get(HyGoalResults res, int which)
+{
+    assert(which >= 0 && which < NRESULT_LISTS);
+    return res->lists[which];
+}
+
+/**
+ * Returns a new list of the installed packages pkg obsoletes, the same as
+ * hy_goal_list_obsoleted_by_package() does.
+ */
+HyPackageList
+hy_goal_results_obsoleted_by(HyGoalResults res, HyPackage pkg)
+{
+    HyPackageList plist = hy_packagelist_create();
+    const Id *triples = res->obsoleters.elements;
+    Id p = package_id(pkg);
+    int lo = 0, hi = res->obsoleters.count / 3;
+
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+	if (triples[3 * mid] < p)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    if (lo == res->obsoleters.count / 3 || triples[3 * lo] != p)
+	return plist;
+    for (int i = 0; i < triples[3 * lo + 2]; ++i)
+	packagelist_push_id(plist, res->sack,
+			    res->obsoleted.elements[triples[3 * lo + 1] + i]);
+    return plist;
+}
+
 int
 hy_goal_get_reason(HyGoal goal, HyPackage pkg)
 {
@@ -51,6 +51,16 @@ enum _hy_goal_actions {
     HY_UPGRADE_ALL	= 1 << 6,
 };
 
+/* the lists of HyGoalResults */
+enum _hy_goal_results_lists {
+    HY_RESULT_ERASURES,
+    HY_RESULT_INSTALLS,
+    HY_RESULT_OBSOLETED,
+    HY_RESULT_REINSTALLS,
+    HY_RESULT_UPGRADES,
+    HY_RESULT_DOWNGRADES
+};
+
 #define HY_REASON_DEP 1
 #define HY_REASON_USER 2
 
@@ -124,6 +134,11 @@ HyPackageList hy_goal_list_downgrades(HyGoal goal);
 HyPackageList hy_goal_list_obsoleted_by_package(HyGoal goal, HyPackage pkg);
 int hy_goal_get_reason(HyGoal goal, HyPackage pkg);
 
+HyGoalResults hy_goal_results(HyGoal goal);
+void hy_goal_results_free(HyGoalResults res);
+HyPackageList hy_goal_results_get(HyGoalResults res, int which);
+HyPackageList hy_goal_results_obsoleted_by(HyGoalResults res, HyPackage pkg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,8 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/utsname.h>
@@ -45,6 +47,7 @@
 #include "errno_internal.h"
 #include "iutil.h"
 #include "package_internal.h"
+#include "packagelist_internal.h"
 #include "packageset_internal.h"
 #include "query.h"
 #include "reldep.h"
@@ -119,9 +122,10 @@ checksum_fp(unsigned char *out, FILE *fp)
     solv_chksum_add(h, CHKSUM_IDENT, strlen(CHKSUM_IDENT));
     while ((l = fread(buf, 1, sizeof(buf), fp)) > 0)
 	solv_chksum_add(h, buf, l);
+    int err = ferror(fp);
     rewind(fp);
     solv_chksum_free(h, out);
-    return 0;
+    return err ? 1 : 0;
 }
 
 /* calls rewind(fp) before returning */
@@ -240,6 +244,96 @@ abspath(const char *path)
     return solv_dupjoin(cwd, "/", path);
 }
 
+struct _MappedFile {
+    const char *data;
+    size_t len;
+    size_t pos;
+};
+
+static ssize_t
+mapped_read(void *cookie, char *buf, size_t size)
+{
+    struct _MappedFile *mf = cookie;
+    size_t n = mf->len - mf->pos;
+
+    if (n > size)
+	n = size;
+    memcpy(buf, mf->data + mf->pos, n);
+    mf->pos += n;
+    return n;
+}
+
+static int
+mapped_seek(void *cookie, off64_t *offset, int whence)
+{
+    struct _MappedFile *mf = cookie;
+    off64_t pos = *offset;
+
+    if (whence == SEEK_CUR)
+	pos += mf->pos;
+    else if (whence == SEEK_END)
+	pos += mf->len;
+    if (pos < 0 || pos > (off64_t)mf->len)
+	return -1;
+    mf->pos = *offset = pos;
+    return 0;
+}
+
+static int
+mapped_close(void *cookie)
+{
+    struct _MappedFile *mf = cookie;
+    int ret = munmap((void *)mf->data, mf->len);
+
+    solv_free(mf);
+    return ret;
+}
+
+/**
+ * Open the cache file fn for reading if its trailing checksum matches cs.
+ *
+ * The file is mapped into memory and read through the returned stream, so
+ * loading it costs no read() calls. Returns NULL if the file does not exist
+ * or is stale.
+ */
+FILE *
+cache_open(const char *fn, const unsigned char *cs)
+{
+    cookie_io_functions_t io = {
+	.read = mapped_read,
+	.seek = mapped_seek,
+	.close = mapped_close
+    };
+    struct stat st;
+    int fd = open(fn, O_RDONLY);
+
+    if (fd < 0)
+	return NULL;
+    if (fstat(fd, &st) || st.st_size < CHKSUM_BYTES) {
+	close(fd);
+	return NULL;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+	return NULL;
+    if (checksum_cmp((unsigned char *)data + st.st_size - CHKSUM_BYTES, cs)) {
+	munmap(data, st.st_size);
+	return NULL;
+    }
+    // start reading the rest of the file in while libsolv parses the head
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    madvise(data, st.st_size, MADV_WILLNEED);
+
+    struct _MappedFile *mf = solv_calloc(1, sizeof(*mf));
+    mf->data = data;
+    mf->len = st.st_size;
+    FILE *fp = fopencookie(mf, "r", io);
+    if (fp == NULL)
+	mapped_close(mf);
+    return fp;
+}
+
 int
 is_readable_rpm(const char *fn)
 {
@@ -506,7 +600,7 @@ void
 queue2plist(HySack sack, Queue *q, HyPackageList plist)
 {
     for (int i = 0; i < q->count; ++i)
-	hy_packagelist_push(plist, package_create(sack, q->elements[i]));
+	packagelist_push_id(plist, sack, q->elements[i]);
 }
 
 /**
@@ -530,32 +624,31 @@ queue2plist(HySack sack, Queue *q, HyPackageList plist)
  * Or 0 if none such package is installed.
  */
 Id
-what_upgrades(Pool *pool, Id pkg)
+what_upgrades(HySack sack, Id pkg)
 {
-    Id l = 0, l_evr = 0;
-    Id p, pp;
+    Pool *pool = sack_pool(sack);
+    const struct _EvrRank *idx = sack_evr_rank(sack);
+    Id l = 0, g = idx->name_group[pkg];
     Solvable *updated, *s = pool_id2solvable(pool, pkg);
 
     assert(pool->installed);
-    assert(pool->whatprovides);
-    FOR_PROVIDES(p, pp, s->name) {
+    // walk down from the highest version, the first match is the one
+    for (int i = idx->group_start[g + 1] - 1; i >= idx->group_start[g]; --i) {
+	Id p = idx->members[i];
 	updated = pool_id2solvable(pool, p);
-	if (updated->repo != pool->installed ||
-	    updated->name != s->name)
+	if (updated->repo != pool->installed)
 	    continue;
 	if (updated->arch != s->arch &&
 	    updated->arch != ARCH_NOARCH &&
 	    s->arch != ARCH_NOARCH)
 	    continue;
-	if (pool_evrcmp(pool, updated->evr, s->evr, EVRCMP_COMPARE) >= 0)
-	    // >= version installed, this pkg can not be used for upgrade
-	    return 0;
-	if (l == 0 ||
-	    pool_evrcmp(pool, updated->evr, l_evr, EVRCMP_COMPARE) > 0) {
-	    l = p;
-	    l_evr = updated->evr;
-	}
+	if (l && idx->rank[p] != idx->rank[l])
+	    break;
+	l = p; // of the same versions prefer the lowest Id
     }
+    if (l && idx->rank[l] >= idx->rank[pkg])
+	// >= version installed, this pkg can not be used for upgrade
+	return 0;
     return l;
 }
 
@@ -573,30 +666,26 @@ what_upgrades(Pool *pool, Id pkg)
  * Or 0 if none such package is installed.
  */
 Id
-what_downgrades(Pool *pool, Id pkg)
+what_downgrades(HySack sack, Id pkg)
 {
-    Id l = 0, l_evr = 0;
-    Id p, pp;
+    Pool *pool = sack_pool(sack);
+    const struct _EvrRank *idx = sack_evr_rank(sack);
+    Id g = idx->name_group[pkg];
     Solvable *updated, *s = pool_id2solvable(pool, pkg);
 
     assert(pool->installed);
-    assert(pool->whatprovides);
-    FOR_PROVIDES(p, pp, s->name) {
+    for (int i = idx->group_start[g]; i < idx->group_start[g + 1]; ++i) {
+	Id p = idx->members[i];
 	updated = pool_id2solvable(pool, p);
 	if (updated->repo != pool->installed ||
-	    updated->name != s->name ||
 	    updated->arch != s->arch)
 	    continue;
-	if (pool_evrcmp(pool, updated->evr, s->evr, EVRCMP_COMPARE) <= 0)
+	if (idx->rank[p] <= idx->rank[pkg])
 	    // <= version installed, this pkg can not be used for downgrade
 	    return 0;
-	if (l == 0 ||
-	    pool_evrcmp(pool, updated->evr, l_evr, EVRCMP_COMPARE) < 0) {
-	    l = p;
-	    l_evr = updated->evr;
-	}
+	return p;
     }
-    return l;
+    return 0;
 }
 
 unsigned long
@@ -57,6 +57,7 @@ const char *pool_checksum_str(Pool *pool, const unsigned char *chksum);
 
 /* filesystem utils */
 char *abspath(const char *path);
+FILE *cache_open(const char *fn, const unsigned char *cs);
 int is_readable_rpm(const char *fn);
 int mkcachedir(char *path);
 int mv(HySack sack, const char *old, const char *new);
@@ -78,12 +79,17 @@ Repo *repo_by_name(HySack sack, const char *name);
 HyRepo hrepo_by_name(HySack sack, const char *name);
 Id str2archid(Pool *pool, const char *s);
 void queue2plist(HySack sack, Queue *q, HyPackageList plist);
-Id what_upgrades(Pool *pool, Id p);
-Id what_downgrades(Pool *pool, Id p);
+Id what_upgrades(HySack sack, Id p);
+Id what_downgrades(HySack sack, Id p);
 static inline int is_package(Pool *pool, Solvable *s)
 {
     return !str_startswith(pool_id2str(pool, s->name), SOLVABLE_NAME_ADVISORY_PREFIX);
 }
+/* for open addressing hash tables of Ids */
+static inline unsigned id_hash(Id id)
+{
+    return (unsigned)id * 2654435761u;
+}
 
 /* package version utils */
 unsigned long pool_get_epoch(Pool *pool, const char *evr);
@@ -19,24 +19,101 @@
  */
 
 #include "assert.h"
+#include <string.h>
 
 // libsolv
+#include <solv/evr.h>
 #include <solv/pool.h>
 #include <solv/repo.h>
 #include <solv/queue.h>
 #include <solv/util.h>
 
 // hawkey
-#include "packagelist.h"
+#include "iutil.h"
+#include "packagelist_internal.h"
 #include "package_internal.h"
+#include "packageset_internal.h"
 #include "sack_internal.h"
 
+/* The Ids are always there, the packages only once somebody asked for them.
+   Lists filled by Id create their packages in 'sack'. */
 struct _HyPackageList {
-    HyPackage *elements;
+    HyPackage *elements;	/* NULL or count entries, NULL until needed */
+    Id *ids;
     int count;
+    HySack sack;
+    Id *hash;		/* open addressing set of Id + 1, NULL until needed */
+    unsigned hashmask;
 };
 
 #define BLOCK_SIZE 31
+/* shorter lists are just scanned */
+#define HASH_MIN_COUNT 16
+
+static void
+hash_insert(Id *hash, unsigned mask, Id id)
+{
+    unsigned h = id_hash(id) & mask;
+
+    for (; hash[h]; h = (h + 1) & mask)
+	if (hash[h] == id + 1)
+	    return;
+    hash[h] = id + 1;
+}
+
+static void
+hash_build(HyPackageList plist)
+{
+    unsigned size = 32;
+
+    while (size < 2 * (unsigned)plist->count)
+	size <<= 1;
+    solv_free(plist->hash);
+    plist->hash = solv_calloc(size, sizeof(Id));
+    plist->hashmask = size - 1;
+    for (int i = 0; i < plist->count; ++i)
+	hash_insert(plist->hash, plist->hashmask, plist->ids[i]);
+}
+
+/* keep the set current after an Id was appended */
+static void
+hash_add(HyPackageList plist, Id id)
+{
+    if (plist->hash == NULL)
+	return;
+    if (2 * (unsigned)plist->count > plist->hashmask)
+	hash_build(plist);
+    else
+	hash_insert(plist->hash, plist->hashmask, id);
+}
+
+static int
+hash_has(const Id *hash, unsigned mask, Id id)
+{
+    for (unsigned h = id_hash(id) & mask; hash[h]; h = (h + 1) & mask)
+	if (hash[h] == id + 1)
+	    return 1;
+    return 0;
+}
+
+/* allocate the package slots, none of the packages are created */
+static void
+packagelist_make_elements(HyPackageList plist)
+{
+    plist->elements = solv_calloc_block(plist->count, sizeof(HyPackage),
+					BLOCK_SIZE);
+}
+
+/* make room for one more entry */
+static void
+packagelist_extend(HyPackageList plist)
+{
+    plist->ids = solv_extend(plist->ids, plist->count, 1, sizeof(Id),
+			     BLOCK_SIZE);
+    if (plist->elements)
+	plist->elements = solv_extend(plist->elements, plist->count, 1,
+				      sizeof(HyPackage), BLOCK_SIZE);
+}
 
 HyPackageList
 hy_packagelist_create(void)
@@ -45,14 +122,35 @@ hy_packagelist_create(void)
     return plist;
 }
 
+/**
+ * Create a list of the Ids set in m, no packages are created yet.
+ */
+HyPackageList
+packagelist_from_map(HySack sack, const Map *m)
+{
+    HyPackageList plist = hy_packagelist_create();
+    Id id;
+
+    plist->sack = sack;
+    plist->ids = solv_extend_resize(NULL, map_count(m), sizeof(Id),
+				    BLOCK_SIZE);
+    FOR_MAP_SET(m, id)
+	plist->ids[plist->count++] = id;
+    return plist;
+}
+
 void
 hy_packagelist_free(HyPackageList plist)
 {
     int i;
 
-    for (i = 0; i < plist->count; ++i)
-	hy_package_free(plist->elements[i]);
+    if (plist->elements)
+	for (i = 0; i < plist->count; ++i)
+	    if (plist->elements[i])
+		hy_package_free(plist->elements[i]);
     solv_free(plist->elements);
+    solv_free(plist->ids);
+    solv_free(plist->hash);
     solv_free(plist);
 }
 
@@ -73,9 +171,24 @@ hy_packagelist_count(HyPackageList plist)
 HyPackage
 hy_packagelist_get(HyPackageList plist, int index)
 {
-    if (index < plist->count)
-	return plist->elements[index];
-    return NULL;
+    if (index >= plist->count)
+	return NULL;
+    if (plist->elements == NULL)
+	packagelist_make_elements(plist);
+    if (plist->elements[index] == NULL)
+	plist->elements[index] = package_create(plist->sack, plist->ids[index]);
+    return plist->elements[index];
+}
+
+/**
+ * Returns the Id of the package at position 'index', without creating the
+ * package.
+ */
+Id
+packagelist_get_id(HyPackageList plist, int index)
+{
+    assert(index < plist->count);
+    return plist->ids[index];
 }
 
 /**
@@ -90,11 +203,23 @@ hy_packagelist_get_clone(HyPackageList plist, int index)
     return hy_package_link(hy_packagelist_get(plist, index));
 }
 
+/**
+ * Returns 1 if a package identical to pkg is in plist.
+ *
+ * Longer lists build a hash set of their Ids on the first call and keep it
+ * current while they grow.
+ */
 int
 hy_packagelist_has(HyPackageList plist, HyPackage pkg)
 {
+    Id id = package_id(pkg);
+
+    if (plist->hash == NULL && plist->count >= HASH_MIN_COUNT)
+	hash_build(plist);
+    if (plist->hash)
+	return hash_has(plist->hash, plist->hashmask, id);
     for (int i = 0; i < plist->count; ++i)
-	if (hy_package_identical(pkg, plist->elements[i]))
+	if (plist->ids[i] == id)
 	    return 1;
     return 0;
 }
@@ -106,7 +231,130 @@ hy_packagelist_has(HyPackageList plist, HyPackage pkg)
  */
 void hy_packagelist_push(HyPackageList plist, HyPackage pkg)
 {
+    if (plist->elements == NULL)
+	packagelist_make_elements(plist);
+    plist->ids = solv_extend(plist->ids, plist->count, 1, sizeof(Id),
+			     BLOCK_SIZE);
     plist->elements = solv_extend(plist->elements, plist->count, 1,
-				  sizeof(pkg), BLOCK_SIZE);
-    plist->elements[plist->count++] = pkg;
+				  sizeof(HyPackage), BLOCK_SIZE);
+    plist->elements[plist->count] = pkg;
+    plist->ids[plist->count++] = package_id(pkg);
+    hash_add(plist, package_id(pkg));
+}
+
+/**
+ * Adds the package with the Id at the end of plist, the package is only
+ * created when it is first asked for.
+ */
+void
+packagelist_push_id(HyPackageList plist, HySack sack, Id id)
+{
+    assert(plist->sack == NULL || plist->sack == sack);
+    plist->sack = sack;
+    packagelist_extend(plist);
+    if (plist->elements)
+	plist->elements[plist->count] = NULL;
+    plist->ids[plist->count++] = id;
+    hash_add(plist, id);
+}
+
+/**
+ * Removes the repeated occurrences of packages from plist, the first one of
+ * each stays where it was.
+ */
+void
+hy_packagelist_dedup(HyPackageList plist)
+{
+    unsigned size = 32;
+    int n = 0;
+
+    while (size < 2 * (unsigned)plist->count)
+	size <<= 1;
+    Id *seen = solv_calloc(size, sizeof(Id));
+    for (int i = 0; i < plist->count; ++i) {
+	Id id = plist->ids[i];
+	if (hash_has(seen, size - 1, id)) {
+	    if (plist->elements && plist->elements[i])
+		hy_package_free(plist->elements[i]);
+	    continue;
+	}
+	hash_insert(seen, size - 1, id);
+	if (plist->elements)
+	    plist->elements[n] = plist->elements[i];
+	plist->ids[n++] = id;
+    }
+    solv_free(seen);
+    plist->count = n;
+}
+
+struct _NevraKey {
+    const char *name;
+    Id evr;
+    const char *arch;
+    Id id;
+    int pos;
+};
+
+static int
+nevra_key_cmp(const void *ap, const void *bp, void *dp)
+{
+    const struct _NevraKey *a = ap, *b = bp;
+    int ret = strcmp(a->name, b->name);
+
+    if (ret)
+	return ret;
+    if (a->evr != b->evr) {
+	ret = pool_evrcmp((Pool *)dp, a->evr, b->evr, EVRCMP_COMPARE);
+	if (ret)
+	    return ret;
+    }
+    ret = strcmp(a->arch, b->arch);
+    if (ret)
+	return ret;
+    if (a->id != b->id)
+	return a->id < b->id ? -1 : 1;
+    return a->pos - b->pos;
+}
+
+/**
+ * Sorts plist by name, evr and arch, the order of hy_package_cmp().
+ *
+ * Packages with the same NEVRA, say from different repos, end up ordered by
+ * their Ids. All the packages in plist must come from one sack.
+ */
+void
+hy_packagelist_sort(HyPackageList plist)
+{
+    HySack sack = plist->sack;
+
+    if (plist->count < 2)
+	return;
+    if (sack == NULL) // filled by hy_packagelist_push() only
+	sack = package_sack(plist->elements[0]);
+
+    Pool *pool = sack_pool(sack);
+    struct _NevraKey *keys = solv_calloc(plist->count, sizeof(*keys));
+    for (int i = 0; i < plist->count; ++i) {
+	Solvable *s = pool_id2solvable(pool, plist->ids[i]);
+	keys[i].name = pool_id2str(pool, s->name);
+	keys[i].evr = s->evr;
+	keys[i].arch = pool_id2str(pool, s->arch);
+	keys[i].id = plist->ids[i];
+	keys[i].pos = i;
+    }
+    solv_sort(keys, plist->count, sizeof(*keys), nevra_key_cmp, pool);
+
+    Id *ids = solv_calloc_block(plist->count, sizeof(Id), BLOCK_SIZE);
+    HyPackage *elements = plist->elements ?
+	solv_calloc_block(plist->count, sizeof(HyPackage), BLOCK_SIZE) : NULL;
+    for (int i = 0; i < plist->count; ++i) {
+	ids[i] = plist->ids[keys[i].pos];
+	if (elements)
+	    elements[i] = plist->elements[keys[i].pos];
+    }
+    solv_free(keys);
+    solv_free(plist->ids);
+    solv_free(plist->elements);
+    plist->ids = ids;
+    plist->elements = elements;
 }
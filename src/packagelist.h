@@ -35,6 +35,8 @@ HyPackage hy_packagelist_get(HyPackageList plist, int index);
 HyPackage hy_packagelist_get_clone(HyPackageList plist, int index);
 int hy_packagelist_has(HyPackageList plist, HyPackage pkg);
 void hy_packagelist_push(HyPackageList plist, HyPackage pkg);
+void hy_packagelist_dedup(HyPackageList plist);
+void hy_packagelist_sort(HyPackageList plist);
 
 #define FOR_PACKAGELIST(pkg, pkglist, i)						\
     for (i = 0; (pkg = hy_packagelist_get(pkglist, i)) != NULL; ++i)
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef HY_PACKAGELIST_INTERNAL_H
+#define HY_PACKAGELIST_INTERNAL_H
+
+// libsolv
+#include <solv/pooltypes.h>
+#include <solv/bitmap.h>
+
+// hawkey
+#include "packagelist.h"
+
+HyPackageList packagelist_from_map(HySack sack, const Map *m);
+void packagelist_push_id(HyPackageList plist, HySack sack, Id id);
+Id packagelist_get_id(HyPackageList plist, int index);
+
+#endif // HY_PACKAGELIST_INTERNAL_H
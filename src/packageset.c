@@ -19,6 +19,9 @@
  */
 
 #include <assert.h>
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
 
 // libsolv
 #include <solv/bitmap.h>
@@ -29,9 +32,23 @@
 #include "packageset_internal.h"
 #include "sack_internal.h"
 
+/* bytes per block of the rank index, 512 bits */
+#define RANK_BLOCK 64
+#define IDS_BLOCK 15
+/* sparse sets up to this size are kept even in tiny pools */
+#define SPARSE_MIN_LIMIT 16
+
+/* Small sets keep their members as a sorted array and only switch to a bitmap
+   over the whole pool once the array would be bigger than that. */
 struct _HyPackageSet {
     HySack sack;
+    int dense;		/* the members are in map, otherwise in ids */
     Map map;
+    unsigned *rank;	/* bits set before each block, NULL until needed */
+    int nblocks;
+    Id *ids;		/* ascending */
+    int nids;
+    Map view;		/* sparse sets only: members as a bitmap, on demand */
 };
 
 // see http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetTable
@@ -43,91 +60,442 @@ static const unsigned char _BitCountLookup[256] =
     B6(0), B6(1), B6(1), B6(2)
 };
 
+static void
+rank_build(HyPackageSet pset)
+{
+    const Map *m = &pset->map;
+    unsigned c = 0;
+
+    pset->nblocks = (m->size + RANK_BLOCK - 1) / RANK_BLOCK;
+    pset->rank = solv_calloc(pset->nblocks + 1, sizeof(unsigned));
+    for (int b = 0; b < pset->nblocks; ++b) {
+	Map block;
+	block.map = m->map + b * RANK_BLOCK;
+	block.size = b + 1 < pset->nblocks ?
+	    RANK_BLOCK : m->size - b * RANK_BLOCK;
+	pset->rank[b] = c;
+	c += map_count(&block);
+    }
+    pset->rank[pset->nblocks] = c;
+}
+
+/**
+ * Return the Id of the index-th member of pset, -1 if there are not that many.
+ *
+ * Binary searches the rank index for the block and counts within it, the
+ * index is built on the first call after the set changed.
+ */
 static Id
-map_index2id(Map *map, unsigned index, Id previous)
+rank_select(HyPackageSet pset, unsigned index)
 {
-    unsigned char *ti = map->map;
-    unsigned char *end = ti + map->size;
-    int enabled;
-    Id id;
+    if (pset->rank == NULL)
+	rank_build(pset);
+    if (index >= pset->rank[pset->nblocks])
+	return -1;
 
-    if (previous >= 0) {
-	ti += previous >> 3;
-	unsigned char byte = *ti; // byte with the previous match
-	byte >>= (previous & 7) + 1; // shift away all previous 1 bits
-	enabled = _BitCountLookup[byte]; // are there any 1 bits left?
+    int lo = 0, hi = pset->nblocks - 1;
+    while (lo < hi) {
+	int mid = lo + (hi - lo + 1) / 2;
+	if (pset->rank[mid] <= index)
+	    lo = mid;
+	else
+	    hi = mid - 1;
+    }
+    index -= pset->rank[lo];
 
-	for (id = previous + 1; enabled; byte >>= 1, id++)
-	    if (byte & 0x01)
-		return id;
-	index = 0; // we are looking for the immediately following index
-	ti++;
+    const unsigned char *ti = pset->map.map + lo * RANK_BLOCK;
+    for (;; ++ti) {
+	unsigned enabled = _BitCountLookup[*ti];
+	if (index < enabled)
+	    break;
+	index -= enabled;
     }
+    unsigned byte = *ti;
+    for (; index; --index)
+	byte &= byte - 1; // drop the lowest bit
+    return ((ti - pset->map.map) << 3) + __builtin_ctz(byte);
+}
 
-    while (ti < end) {
-	enabled = _BitCountLookup[*ti];
+/**
+ * Return the lowest bit set in m that is greater than previous, -1 if there is
+ * none.
+ *
+ * Runs of zero bytes are skipped a 64-bit word at a time.
+ */
+Id
+map_next(const Map *m, Id previous)
+{
+    const unsigned char *ti = m->map;
+    const unsigned char *end = ti + m->size;
+    Id id = previous + 1;
+    const unsigned char *p = ti + (id >> 3);
 
-	if (index >= enabled ){
-	    index -= enabled;
-	    ti++;
+    if (p >= end)
+	return -1;
+    unsigned char byte = *p >> (id & 7);
+    if (byte)
+	return id + __builtin_ctz(byte);
+
+    // reach a word boundary
+    for (p++; p < end && ((uintptr_t)p & 7); p++)
+	if (*p)
+	    return ((p - ti) << 3) + __builtin_ctz(*p);
+
+    for (; p + 8 <= end; p += 8) {
+	uint64_t word;
+	memcpy(&word, p, sizeof(word));
+	if (!word)
 	    continue;
-	}
-	id = (ti - map->map) << 3;
-
-	index++;
-	for (unsigned char byte = *ti; index; byte >>= 1) {
-	    if ((byte & 0x01))
-		index--;
-	    if (index)
-		id++;
-	}
-	return id;
+#if __BYTE_ORDER == __BIG_ENDIAN
+	word = __builtin_bswap64(word);
+#endif
+	return ((p - ti) << 3) + __builtin_ctzll(word);
     }
+
+    for (; p < end; p++)
+	if (*p)
+	    return ((p - ti) << 3) + __builtin_ctz(*p);
     return -1;
 }
 
-Id
-packageset_get_pkgid(HyPackageSet pset, int index, Id previous)
+/**
+ * Set the bits [lo, hi) in m, whole bytes are filled at once.
+ */
+void
+map_set_range(Map *m, Id lo, Id hi)
 {
-    Id id = map_index2id(&pset->map, index, previous);
-    assert(id >= 0);
-    return id;
+    assert(lo <= hi && hi <= (m->size << 3));
+    if (lo == hi)
+	return;
+    if ((lo >> 3) == (hi >> 3)) {
+	m->map[lo >> 3] |= (0xff << (lo & 7)) & ~(0xff << (hi & 7));
+	return;
+    }
+    if (lo & 7) {
+	m->map[lo >> 3] |= 0xff << (lo & 7);
+	lo = (lo | 7) + 1;
+    }
+    memset(m->map + (lo >> 3), 0xff, (hi >> 3) - (lo >> 3));
+    if (hi & 7)
+	m->map[hi >> 3] |= ~(0xff << (hi & 7));
 }
 
+/**
+ * Return the number of bits set in m.
+ *
+ * The bulk of the map is counted a 64-bit word at a time so the compiler can
+ * use the hardware popcount instruction where there is one.
+ */
 unsigned
-map_count(Map *m)
+map_count(const Map *m)
 {
-    unsigned char *ti = m->map;
-    unsigned char *end = ti + m->size;
+    const unsigned char *ti = m->map;
+    const unsigned char *end = ti + m->size;
     unsigned c = 0;
 
+    for (; ti + 8 <= end; ti += 8) {
+	uint64_t word;
+	memcpy(&word, ti, sizeof(word));
+	c += __builtin_popcountll(word);
+    }
     while (ti < end)
 	c += _BitCountLookup[*ti++];
 
     return c;
 }
 
+#define MAP_COMBINE_LOOP(a, b, n, OP)				\
+    do {								\
+	int i = 0;							\
+	for (; i + 8 <= n; i += 8) {					\
+	    uint64_t x, y;						\
+	    memcpy(&x, a + i, sizeof(x));				\
+	    memcpy(&y, b + i, sizeof(y));				\
+	    x = OP(x, y);						\
+	    memcpy(a + i, &x, sizeof(x));				\
+	}								\
+	for (; i < n; ++i)						\
+	    a[i] = OP(a[i], b[i]);					\
+    } while (0)
+
+#define OP_OR(x, y) ((x) | (y))
+#define OP_AND(x, y) ((x) & (y))
+#define OP_SUBTRACT(x, y) ((x) & ~(y))
+#define OP_XOR(x, y) ((x) ^ (y))
+
+/**
+ * Combine other into m, 64 bits at a time.
+ *
+ * The maps can differ in size, m grows for MAP_OP_OR and MAP_OP_XOR.
+ */
+void
+map_combine(Map *m, const Map *other, enum _MapOp op)
+{
+    if ((op == MAP_OP_OR || op == MAP_OP_XOR) && other->size > m->size)
+	map_grow(m, other->size << 3);
+
+    unsigned char *a = m->map;
+    const unsigned char *b = other->map;
+    int n = m->size < other->size ? m->size : other->size;
+
+    switch (op) {
+    case MAP_OP_OR:
+	MAP_COMBINE_LOOP(a, b, n, OP_OR);
+	break;
+    case MAP_OP_AND:
+	MAP_COMBINE_LOOP(a, b, n, OP_AND);
+	memset(a + n, 0, m->size - n);
+	break;
+    case MAP_OP_SUBTRACT:
+	MAP_COMBINE_LOOP(a, b, n, OP_SUBTRACT);
+	break;
+    case MAP_OP_XOR:
+	MAP_COMBINE_LOOP(a, b, n, OP_XOR);
+	break;
+    }
+}
+
+/**
+ * Return 1 if every bit set in m is also set in other.
+ */
+int
+map_is_subset(const Map *m, const Map *other)
+{
+    const unsigned char *a = m->map, *b = other->map;
+    int n = m->size < other->size ? m->size : other->size;
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+	uint64_t x, y;
+	memcpy(&x, a + i, sizeof(x));
+	memcpy(&y, b + i, sizeof(y));
+	if (x & ~y)
+	    return 0;
+    }
+    for (; i < m->size; ++i)
+	if (a[i] & ~(i < n ? b[i] : 0))
+	    return 0;
+    return 1;
+}
+
+static int
+id_sortcmp(const void *ap, const void *bp, void *dp)
+{
+    Id a = *(Id *)ap, b = *(Id *)bp;
+    return a < b ? -1 : a > b;
+}
+
+static int
+sparse_limit(HySack sack)
+{
+    // an Id array of this size takes as much memory as the bitmap
+    int limit = sack_pool(sack)->nsolvables / (8 * sizeof(Id));
+    return limit < SPARSE_MIN_LIMIT ? SPARSE_MIN_LIMIT : limit;
+}
+
+/* position of the first member not lower than id, pset must be sparse */
+static int
+ids_lower_bound(HyPackageSet pset, Id id)
+{
+    int lo = 0, hi = pset->nids;
+
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+	if (pset->ids[mid] < id)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+int
+packageset_has_id(HyPackageSet pset, Id id)
+{
+    if (pset->dense)
+	return id < (pset->map.size << 3) && MAPTST(&pset->map, id);
+    int pos = ids_lower_bound(pset, id);
+    return pos < pset->nids && pset->ids[pos] == id;
+}
+
+static void
+packageset_densify(HyPackageSet pset)
+{
+    int nbits = sack_pool(pset->sack)->nsolvables;
+
+    if (pset->dense)
+	return;
+    if (pset->nids && pset->ids[pset->nids - 1] >= nbits)
+	nbits = pset->ids[pset->nids - 1] + 1;
+    map_free(&pset->view);
+    map_init(&pset->map, nbits);
+    for (int i = 0; i < pset->nids; ++i)
+	MAPSET(&pset->map, pset->ids[i]);
+    pset->ids = solv_free(pset->ids);
+    pset->nids = 0;
+    pset->dense = 1;
+}
+
+/* call after the members changed */
+static void
+packageset_changed(HyPackageSet pset)
+{
+    map_free(&pset->view);
+    if (pset->dense)
+	pset->rank = solv_free(pset->rank);
+    else if (pset->nids > sparse_limit(pset->sack))
+	packageset_densify(pset);
+}
+
+static void
+dense_grow(HyPackageSet pset, Id id)
+{
+    if (id >= (pset->map.size << 3))
+	map_grow(&pset->map, id + 1);
+}
+
+/* keep only the sparse members for which the bit in m equals keep */
+static void
+sparse_filter(HyPackageSet pset, const Map *m, int keep)
+{
+    int n = 0;
+
+    for (int i = 0; i < pset->nids; ++i) {
+	Id id = pset->ids[i];
+	int set = id < (m->size << 3) && MAPTST(m, id);
+	if (set == keep)
+	    pset->ids[n++] = id;
+    }
+    pset->nids = n;
+}
+
+static void
+sparse_merge(HyPackageSet pset, HyPackageSet other, enum _MapOp op)
+{
+    const Id *a = pset->ids, *b = other->ids;
+    int na = pset->nids, nb = other->nids;
+    Id *res = solv_extend_resize(NULL, na + nb, sizeof(Id), IDS_BLOCK);
+    int i = 0, j = 0, n = 0;
+
+    while (i < na || j < nb) {
+	if (j == nb || (i < na && a[i] < b[j])) {
+	    if (op != MAP_OP_AND)
+		res[n++] = a[i];
+	    i++;
+	} else if (i == na || b[j] < a[i]) {
+	    if (op == MAP_OP_OR || op == MAP_OP_XOR)
+		res[n++] = b[j];
+	    j++;
+	} else {
+	    if (op == MAP_OP_OR || op == MAP_OP_AND)
+		res[n++] = a[i];
+	    i++;
+	    j++;
+	}
+    }
+    solv_free(pset->ids);
+    pset->ids = res;
+    pset->nids = n;
+}
+
 HyPackageSet
 packageset_from_bitmap(HySack sack, Map *m)
 {
     HyPackageSet pset = solv_calloc(1, sizeof(*pset));
+    unsigned count = map_count(m);
+
     pset->sack = sack;
-    map_init_clone(&pset->map, m);
+    if (count > (unsigned)sparse_limit(sack)) {
+	pset->dense = 1;
+	map_init_clone(&pset->map, m);
+	return pset;
+    }
+    pset->ids = solv_extend_resize(NULL, count, sizeof(Id), IDS_BLOCK);
+    for (Id id = map_next(m, -1); id >= 0; id = map_next(m, id))
+	pset->ids[pset->nids++] = id;
     return pset;
 }
 
+/**
+ * Return the members of pset as a bitmap for the caller to change.
+ *
+ * A sparse set is turned into a dense one for good and the rank index is
+ * dropped, so call this again before each change instead of keeping the map
+ * around. Callers that only read use packageset_map_view().
+ */
 Map *
 packageset_get_map(HyPackageSet pset)
 {
+    packageset_densify(pset);
+    pset->rank = solv_free(pset->rank);
     return &pset->map;
 }
 
+/**
+ * Return the members of pset as a bitmap that must not be changed.
+ *
+ * A sparse set stays sparse, the bitmap is built on the first call and kept
+ * until the members change.
+ */
+const Map *
+packageset_map_view(HyPackageSet pset)
+{
+    if (pset->dense)
+	return &pset->map;
+    if (pset->view.map == NULL) {
+	int nbits = sack_pool(pset->sack)->nsolvables;
+	if (pset->nids && pset->ids[pset->nids - 1] >= nbits)
+	    nbits = pset->ids[pset->nids - 1] + 1;
+	map_init(&pset->view, nbits);
+	for (int i = 0; i < pset->nids; ++i)
+	    MAPSET(&pset->view, pset->ids[i]);
+    }
+    return &pset->view;
+}
+
+/**
+ * Set the bits of the members of pset in m.
+ */
+void
+packageset_to_map(HyPackageSet pset, Map *m)
+{
+    if (pset->dense) {
+	map_combine(m, &pset->map, MAP_OP_OR);
+	return;
+    }
+    for (int i = 0; i < pset->nids; ++i) {
+	if (pset->ids[i] >= (m->size << 3))
+	    map_grow(m, pset->ids[i] + 1);
+	MAPSET(m, pset->ids[i]);
+    }
+}
+
+/**
+ * Return the index-th member of pset, or when previous is not negative the
+ * member following previous.
+ */
+Id
+packageset_get_pkgid(HyPackageSet pset, int index, Id previous)
+{
+    Id id;
+
+    if (pset->dense)
+	id = previous >= 0 ?
+	    map_next(&pset->map, previous) : rank_select(pset, index);
+    else {
+	if (previous >= 0)
+	    index = ids_lower_bound(pset, previous + 1);
+	id = index < pset->nids ? pset->ids[index] : -1;
+    }
+    assert(id >= 0);
+    return id;
+}
+
 HyPackageSet
 hy_packageset_create(HySack sack)
 {
     HyPackageSet pset = solv_calloc(1, sizeof(*pset));
     pset->sack = sack;
-    map_init(&pset->map, sack_pool(sack)->nsolvables);
     return pset;
 }
 
@@ -136,7 +504,15 @@ hy_packageset_clone(HyPackageSet pset)
 {
     HyPackageSet new = solv_malloc(sizeof(*new));
     memcpy(new, pset, sizeof(*pset));
-    map_init_clone(&new->map, &pset->map);
+    map_init(&new->view, 0);
+    if (pset->dense) {
+	map_init_clone(&new->map, &pset->map);
+	new->rank = NULL;
+    } else {
+	new->ids = solv_extend_resize(NULL, pset->nids, sizeof(Id), IDS_BLOCK);
+	if (pset->nids)
+	    memcpy(new->ids, pset->ids, pset->nids * sizeof(Id));
+    }
     return new;
 }
 
@@ -144,26 +520,121 @@ void
 hy_packageset_free(HyPackageSet pset)
 {
     map_free(&pset->map);
+    map_free(&pset->view);
+    solv_free(pset->rank);
+    solv_free(pset->ids);
     solv_free(pset);
 }
 
 void
 hy_packageset_add(HyPackageSet pset, HyPackage pkg)
 {
-    MAPSET(&pset->map, package_id(pkg));
+    Id id = package_id(pkg);
+
     hy_package_free(pkg);
+    packageset_add_ids(pset, &id, 1);
+}
+
+/**
+ * Add the packages with the given Ids to pset.
+ */
+void
+packageset_add_ids(HyPackageSet pset, const Id *ids, int count)
+{
+    if (pset->dense) {
+	for (int i = 0; i < count; ++i) {
+	    dense_grow(pset, ids[i]);
+	    MAPSET(&pset->map, ids[i]);
+	}
+    } else if (count == 1) {
+	int pos = ids_lower_bound(pset, ids[0]);
+	if (pos < pset->nids && pset->ids[pos] == ids[0])
+	    return;
+	pset->ids = solv_extend(pset->ids, pset->nids, 1, sizeof(Id), IDS_BLOCK);
+	memmove(pset->ids + pos + 1, pset->ids + pos,
+		(pset->nids - pos) * sizeof(Id));
+	pset->ids[pos] = ids[0];
+	pset->nids++;
+    } else {
+	HyPackageSet added = hy_packageset_create(pset->sack);
+	added->ids = solv_extend_resize(NULL, count, sizeof(Id), IDS_BLOCK);
+	memcpy(added->ids, ids, count * sizeof(Id));
+	solv_sort(added->ids, count, sizeof(Id), id_sortcmp, NULL);
+	for (int i = 0; i < count; ++i)
+	    if (i == 0 || added->ids[i] != added->ids[added->nids - 1])
+		added->ids[added->nids++] = added->ids[i];
+	sparse_merge(pset, added, MAP_OP_OR);
+	hy_packageset_free(added);
+    }
+    packageset_changed(pset);
+}
+
+/**
+ * Remove the packages with the given Ids from pset.
+ */
+void
+packageset_remove_ids(HyPackageSet pset, const Id *ids, int count)
+{
+    for (int i = 0; i < count; ++i) {
+	Id id = ids[i];
+	if (pset->dense) {
+	    if (id < (pset->map.size << 3))
+		MAPCLR(&pset->map, id);
+	    continue;
+	}
+	int pos = ids_lower_bound(pset, id);
+	if (pos == pset->nids || pset->ids[pos] != id)
+	    continue;
+	memmove(pset->ids + pos, pset->ids + pos + 1,
+		(pset->nids - pos - 1) * sizeof(Id));
+	pset->nids--;
+    }
+    packageset_changed(pset);
 }
 
 unsigned
 hy_packageset_count(HyPackageSet pset)
 {
+    if (!pset->dense)
+	return pset->nids;
     return map_count(&pset->map);
 }
 
 HyPackage
 hy_packageset_get_clone(HyPackageSet pset, int index)
 {
-    Id id = map_index2id(&pset->map, index, -1);
+    Id id;
+
+    if (pset->dense)
+	id = rank_select(pset, index);
+    else
+	id = index < pset->nids ? pset->ids[index] : -1;
+    if (id < 0)
+	return NULL;
+    return package_create(pset->sack, id);
+}
+
+/**
+ * Return the member following previous, the first member if previous is NULL.
+ *
+ * Frees previous so a whole set can be walked with:
+ *
+ *     for (pkg = hy_packageset_next(pset, NULL); pkg;
+ *          pkg = hy_packageset_next(pset, pkg))
+ */
+HyPackage
+hy_packageset_next(HyPackageSet pset, HyPackage previous)
+{
+    Id id = previous ? package_id(previous) : -1;
+
+    if (previous)
+	hy_package_free(previous);
+    if (pset->dense)
+	id = map_next(&pset->map, id);
+    else {
+	int pos = ids_lower_bound(pset, id + 1);
+	id = pos < pset->nids ? pset->ids[pos] : -1;
+    }
     if (id < 0)
 	return NULL;
     return package_create(pset->sack, id);
@@ -172,5 +643,142 @@ hy_packageset_get_clone(HyPackageSet pset, int index)
 int
 hy_packageset_has(HyPackageSet pset, HyPackage pkg)
 {
-    return MAPTST(&pset->map, package_id(pkg));
+    return packageset_has_id(pset, package_id(pkg));
+}
+
+static void
+packageset_combine(HyPackageSet pset, HyPackageSet other, enum _MapOp op)
+{
+    if (!pset->dense && !other->dense)
+	sparse_merge(pset, other, op);
+    else if (!pset->dense && op == MAP_OP_AND)
+	sparse_filter(pset, &other->map, 1);
+    else if (!pset->dense && op == MAP_OP_SUBTRACT)
+	sparse_filter(pset, &other->map, 0);
+    else if (other->dense) {
+	packageset_densify(pset);
+	map_combine(&pset->map, &other->map, op);
+    } else if (op == MAP_OP_AND) {
+	// the result is no bigger than the sparse other
+	Map m = pset->map;
+	pset->map.map = NULL;
+	pset->map.size = 0;
+	pset->dense = 0;
+	pset->rank = solv_free(pset->rank);
+	pset->ids = solv_extend_resize(NULL, other->nids, sizeof(Id),
+				       IDS_BLOCK);
+	if (other->nids)
+	    memcpy(pset->ids, other->ids, other->nids * sizeof(Id));
+	pset->nids = other->nids;
+	sparse_filter(pset, &m, 1);
+	map_free(&m);
+    } else {
+	for (int i = 0; i < other->nids; ++i) {
+	    Id id = other->ids[i];
+	    if (op == MAP_OP_SUBTRACT) {
+		if (id < (pset->map.size << 3))
+		    MAPCLR(&pset->map, id);
+		continue;
+	    }
+	    dense_grow(pset, id);
+	    if (op == MAP_OP_XOR && MAPTST(&pset->map, id))
+		MAPCLR(&pset->map, id);
+	    else
+		MAPSET(&pset->map, id);
+	}
+    }
+    packageset_changed(pset);
+}
+
+static HyPackageSet
+packageset_combine_clone(HyPackageSet pset, HyPackageSet other,
+			 enum _MapOp op)
+{
+    HyPackageSet new = hy_packageset_clone(pset);
+    packageset_combine(new, other, op);
+    return new;
+}
+
+/**
+ * Add the members of other to pset.
+ */
+void
+hy_packageset_union(HyPackageSet pset, HyPackageSet other)
+{
+    packageset_combine(pset, other, MAP_OP_OR);
+}
+
+/**
+ * Remove the members of pset that are not in other.
+ */
+void
+hy_packageset_intersection(HyPackageSet pset, HyPackageSet other)
+{
+    packageset_combine(pset, other, MAP_OP_AND);
+}
+
+/**
+ * Remove the members of other from pset.
+ */
+void
+hy_packageset_difference(HyPackageSet pset, HyPackageSet other)
+{
+    packageset_combine(pset, other, MAP_OP_SUBTRACT);
+}
+
+/**
+ * Keep in pset the packages that are in exactly one of pset and other.
+ */
+void
+hy_packageset_symmetric_difference(HyPackageSet pset, HyPackageSet other)
+{
+    packageset_combine(pset, other, MAP_OP_XOR);
+}
+
+HyPackageSet
+hy_packageset_union_clone(HyPackageSet pset, HyPackageSet other)
+{
+    return packageset_combine_clone(pset, other, MAP_OP_OR);
+}
+
+HyPackageSet
+hy_packageset_intersection_clone(HyPackageSet pset, HyPackageSet other)
+{
+    return packageset_combine_clone(pset, other, MAP_OP_AND);
+}
+
+HyPackageSet
+hy_packageset_difference_clone(HyPackageSet pset, HyPackageSet other)
+{
+    return packageset_combine_clone(pset, other, MAP_OP_SUBTRACT);
+}
+
+HyPackageSet
+hy_packageset_symmetric_difference_clone(HyPackageSet pset,
+					 HyPackageSet other)
+{
+    return packageset_combine_clone(pset, other, MAP_OP_XOR);
+}
+
+/**
+ * Return 1 if every member of pset is in other.
+ */
+int
+hy_packageset_is_subset(HyPackageSet pset, HyPackageSet other)
+{
+    if (pset->dense && other->dense)
+	return map_is_subset(&pset->map, &other->map);
+    if (pset->dense) {
+	if (hy_packageset_count(pset) > (unsigned)other->nids)
+	    return 0;
+	for (Id id = map_next(&pset->map, -1); id >= 0;
+	     id = map_next(&pset->map, id))
+	    if (!packageset_has_id(other, id))
+		return 0;
+	return 1;
+    }
+    for (int i = 0; i < pset->nids; ++i)
+	if (!packageset_has_id(other, pset->ids[i]))
+	    return 0;
+    return 1;
 }
@@ -34,8 +34,22 @@ void hy_packageset_free(HyPackageSet pset);
 void hy_packageset_add(HyPackageSet pset, HyPackage pkg);
 unsigned hy_packageset_count(HyPackageSet pset);
 HyPackage hy_packageset_get_clone(HyPackageSet pset, int index);
+HyPackage hy_packageset_next(HyPackageSet pset, HyPackage previous);
 int hy_packageset_has(HyPackageSet pset, HyPackage pkg);
 
+void hy_packageset_union(HyPackageSet pset, HyPackageSet other);
+void hy_packageset_intersection(HyPackageSet pset, HyPackageSet other);
+void hy_packageset_difference(HyPackageSet pset, HyPackageSet other);
+void hy_packageset_symmetric_difference(HyPackageSet pset, HyPackageSet other);
+HyPackageSet hy_packageset_union_clone(HyPackageSet pset, HyPackageSet other);
+HyPackageSet hy_packageset_intersection_clone(HyPackageSet pset,
+					      HyPackageSet other);
+HyPackageSet hy_packageset_difference_clone(HyPackageSet pset,
+					    HyPackageSet other);
+HyPackageSet hy_packageset_symmetric_difference_clone(HyPackageSet pset,
+						      HyPackageSet other);
+int hy_packageset_is_subset(HyPackageSet pset, HyPackageSet other);
+
 #ifdef __cplusplus
 }
 #endif
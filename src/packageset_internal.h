@@ -28,9 +28,29 @@
 // hawkey
 #include "packageset.h"
 
-unsigned map_count(Map *m);
+enum _MapOp {
+    MAP_OP_OR,
+    MAP_OP_AND,
+    MAP_OP_SUBTRACT,
+    MAP_OP_XOR
+};
+
+unsigned map_count(const Map *m);
+void map_combine(Map *m, const Map *other, enum _MapOp op);
+int map_is_subset(const Map *m, const Map *other);
+Id map_next(const Map *m, Id previous);
+void map_set_range(Map *m, Id lo, Id hi);
 HyPackageSet packageset_from_bitmap(HySack sack, Map *m);
 Map *packageset_get_map(HyPackageSet pset);
+const Map *packageset_map_view(HyPackageSet pset);
+void packageset_to_map(HyPackageSet pset, Map *m);
+int packageset_has_id(HyPackageSet pset, Id id);
 Id packageset_get_pkgid(HyPackageSet pset, int index, Id previous);
+void packageset_add_ids(HyPackageSet pset, const Id *ids, int count);
+void packageset_remove_ids(HyPackageSet pset, const Id *ids, int count);
+
+/* iterate over the Ids set in m, ascending */
+#define FOR_MAP_SET(m, id)						\
+    for (id = map_next(m, 0); id >= 0; id = map_next(m, id))
 
 #endif // HY_PACKAGESET_INTERNAL_H
@@ -41,7 +41,8 @@ __all__ = [
     # functions
     'chksum_name', 'chksum_type', 'split_nevra',
     # classes
-    'Goal', 'NEVRA', 'Package', 'Query', 'Repo', 'Sack', 'Selector', 'Subject']
+    'Goal', 'GoalResults', 'NEVRA', 'Package', 'Query', 'Repo', 'Sack',
+    'Selector', 'Subject']
 
 _QUERY_KEYNAME_MAP = {
     'pkg': _hawkey.PKG,
@@ -174,6 +175,10 @@ class NEVRA(_hawkey.NEVRA):
             not self.release and not self.arch
 
 
+GoalResults = collections.namedtuple('GoalResults', [
+    'erasures', 'installs', 'obsoleted', 'reinstalls', 'upgrades',
+    'downgrades', 'obsoleted_by'])
+
 class Goal(_hawkey.Goal):
     _reserved_kw = set(['package', 'select'])
     _flag_kw = set(['clean_deps', 'check_installed'])
@@ -209,6 +214,14 @@ class Goal(_hawkey.Goal):
     def problems(self):
         return [self.describe_problem(i) for i in range(0, self.count_problems())]
 
+    def list_results(self):
+        """ All of the resolved transaction in one GoalResults.
+
+            obsoleted_by maps the incoming packages that replace something
+            to the list of the packages they obsolete.
+        """
+        return GoalResults(*self._list_results())
+
     def run(self, callback=None, **kwargs):
         ret = super(Goal, self).run(**kwargs)
         if callback:
@@ -301,7 +314,9 @@ class Query(_hawkey.Query):
         return len(self.run())
 
     def count(self):
-        return len(self)
+        if self._result is not None:
+            return len(self._result)
+        return super(Query, self).count()
 
     @property
     def result(self):
@@ -346,6 +361,30 @@ class Query(_hawkey.Query):
         new_query = type(self)(query=self)
         return super(Query, new_query).union(other)
 
+    def symmetric_difference(self, other):
+        new_query = type(self)(query=self)
+        return super(Query, new_query).symmetric_difference(other)
+
+    def __and__(self, other):
+        if not isinstance(other, _hawkey.Query):
+            return NotImplemented
+        return self.intersection(other)
+
+    def __or__(self, other):
+        if not isinstance(other, _hawkey.Query):
+            return NotImplemented
+        return self.union(other)
+
+    def __sub__(self, other):
+        if not isinstance(other, _hawkey.Query):
+            return NotImplemented
+        return self.difference(other)
+
+    def __xor__(self, other):
+        if not isinstance(other, _hawkey.Query):
+            return NotImplemented
+        return self.symmetric_difference(other)
+
 
 class Selector(_hawkey.Selector):
 
@@ -480,25 +480,30 @@ write_debugdata(_GoalObject *self, PyObject *dir_str)
     Py_RETURN_NONE;
 }
 
+static PyObject *
+no_results_error(void)
+{
+    switch (hy_get_errno()) {
+    case HY_E_OP:
+	PyErr_SetString(HyExc_Value, "Goal has not been run yet.");
+	break;
+    case HY_E_NO_SOLUTION:
+	PyErr_SetString(HyExc_Runtime, "Goal could not find a solution.");
+	break;
+    default:
+	assert(0);
+    }
+    return NULL;
+}
+
 static PyObject *
 list_generic(_GoalObject *self, HyPackageList (*func)(HyGoal))
 {
     HyPackageList plist = func(self->goal);
     PyObject *list;
 
-    if (!plist) {
-	switch (hy_get_errno()) {
-	case HY_E_OP:
-	    PyErr_SetString(HyExc_Value, "Goal has not been run yet.");
-	    break;
-	case HY_E_NO_SOLUTION:
-	    PyErr_SetString(HyExc_Runtime, "Goal could not find a solution.");
-	    break;
-	default:
-	    assert(0);
-	}
-	return NULL;
-    }
+    if (!plist)
+	return no_results_error();
     list = packagelist_to_pylist(plist, self->sack);
     hy_packagelist_free(plist);
     return list;
@@ -559,6 +564,68 @@ obsoleted_by_package(_GoalObject *self, PyObject *pkg)
     return list;
 }
 
+/* map the incoming packages in list to what they obsolete */
+static int
+fill_obsoleted_by(HyGoalResults res, PyObject *list, PyObject *dict,
+		  PyObject *sack)
+{
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(list); ++i) {
+	PyObject *pkg = PyList_GET_ITEM(list, i);
+	HyPackageList plist = hy_goal_results_obsoleted_by(res,
+							   packageFromPyObject(pkg));
+	int ret = 0;
+
+	if (hy_packagelist_count(plist)) {
+	    PyObject *obsoleted = packagelist_to_pylist(plist, sack);
+	    ret = obsoleted ? PyDict_SetItem(dict, pkg, obsoleted) : -1;
+	    Py_XDECREF(obsoleted);
+	}
+	hy_packagelist_free(plist);
+	if (ret)
+	    return -1;
+    }
+    return 0;
+}
+
+static PyObject *
+list_results(_GoalObject *self, PyObject *unused)
+{
+    static const int incoming[] = {
+	HY_RESULT_INSTALLS, HY_RESULT_REINSTALLS, HY_RESULT_UPGRADES,
+	HY_RESULT_DOWNGRADES
+    };
+    HyGoalResults res = hy_goal_results(self->goal);
+    PyObject *tuple, *dict;
+
+    if (res == NULL)
+	return no_results_error();
+    tuple = PyTuple_New(HY_RESULT_DOWNGRADES + 2);
+    if (tuple == NULL)
+	goto fail;
+    for (int i = HY_RESULT_ERASURES; i <= HY_RESULT_DOWNGRADES; ++i) {
+	PyObject *list = packagelist_to_pylist(hy_goal_results_get(res, i),
+					       self->sack);
+	if (list == NULL)
+	    goto fail;
+	PyTuple_SET_ITEM(tuple, i, list);
+    }
+    dict = PyDict_New();
+    if (dict == NULL)
+	goto fail;
+    PyTuple_SET_ITEM(tuple, HY_RESULT_DOWNGRADES + 1, dict);
+    for (unsigned i = 0; i < sizeof(incoming) / sizeof(*incoming); ++i)
+	if (fill_obsoleted_by(res, PyTuple_GET_ITEM(tuple, incoming[i]), dict,
+			      self->sack))
+	    goto fail;
+    hy_goal_results_free(res);
+    return tuple;
+
+ fail:
+    Py_XDECREF(tuple);
+    hy_goal_results_free(res);
+    return NULL;
+}
+
 static PyObject *
 get_reason(_GoalObject *self, PyObject *pkg)
 {
@@ -636,6 +703,7 @@ static struct PyMethodDef goal_methods[] = {
     {"list_upgrades",	(PyCFunction)list_upgrades,	METH_NOARGS,	NULL},
     {"obsoleted_by_package",(PyCFunction)obsoleted_by_package,
      METH_O, NULL},
+    {"_list_results",	(PyCFunction)list_results,	METH_NOARGS,	NULL},
     {"get_reason",	(PyCFunction)get_reason,	METH_O,		NULL},
     {NULL}                      /* sentinel */
 };
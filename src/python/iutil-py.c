@@ -25,7 +25,7 @@
 #include "src/advisorypkg.h"
 #include "src/advisoryref.h"
 #include "src/package_internal.h"
-#include "src/packagelist.h"
+#include "src/packagelist_internal.h"
 #include "src/packageset_internal.h"
 #include "src/reldep_internal.h"
 #include "src/iutil.h"
@@ -136,7 +136,6 @@ advisoryreflist_to_pylist(const HyAdvisoryRefList advisoryreflist, PyObject *sac
 PyObject *
 packagelist_to_pylist(HyPackageList plist, PyObject *sack)
 {
-    HyPackage cpkg;
     PyObject *list;
     PyObject *retval;
 
@@ -145,9 +144,9 @@ packagelist_to_pylist(HyPackageList plist, PyObject *sack)
 	return NULL;
     retval = list;
 
-    int i;
-    FOR_PACKAGELIST(cpkg, plist, i) {
-	PyObject *package = new_package(sack, package_id(cpkg));
+    const int count = hy_packagelist_count(plist);
+    for (int i = 0; i < count; ++i) {
+	PyObject *package = new_package(sack, packagelist_get_id(plist, i));
 	if (package == NULL) {
 	    retval = NULL;
 	    break;
@@ -316,6 +316,12 @@ run(_QueryObject *self, PyObject *unused)
     return list;
 }
 
+static PyObject *
+count(_QueryObject *self, PyObject *unused)
+{
+    return PyLong_FromLong(hy_query_count(self->query));
+}
+
 static PyObject *
 apply(PyObject *self, PyObject *unused)
 {
@@ -354,6 +360,16 @@ q_difference(PyObject *self, PyObject *other)
     return self;
 }
 
+static PyObject *
+q_symmetric_difference(PyObject *self, PyObject *other)
+{
+    HyQuery self_q = ((_QueryObject *) self)->query;
+    HyQuery other_q = ((_QueryObject *) other)->query;
+    hy_query_symmetric_difference(self_q, other_q);
+    Py_INCREF(self);
+    return self;
+}
+
 static struct PyMethodDef query_methods[] = {
     {"clear", (PyCFunction)clear, METH_NOARGS,
      NULL},
@@ -363,12 +379,16 @@ static struct PyMethodDef query_methods[] = {
      NULL},
     {"apply", (PyCFunction)apply, METH_NOARGS,
      NULL},
+    {"count", (PyCFunction)count, METH_NOARGS,
+     NULL},
     {"union", (PyCFunction)q_union, METH_O,
      NULL},
     {"intersection", (PyCFunction)q_intersection, METH_O,
      NULL},
     {"difference", (PyCFunction)q_difference, METH_O,
      NULL},
+    {"symmetric_difference", (PyCFunction)q_symmetric_difference, METH_O,
+     NULL},
     {NULL}                      /* sentinel */
 };
 
@@ -157,6 +157,35 @@ set_str(_RepoObject *self, PyObject *value, void *closure)
     return 0;
 }
 
+static PyObject *
+get_load_times(_RepoObject *self, void *unused)
+{
+    static const struct {
+	const char *name;
+	int which;
+    } stages[] = {
+	{"decompress", HY_REPO_TIME_DECOMPRESS},
+	{"decompress_stall", HY_REPO_TIME_DECOMPRESS_STALL},
+	{"parse", HY_REPO_TIME_PARSE},
+	{"parse_stall", HY_REPO_TIME_PARSE_STALL}
+    };
+    PyObject *dict = PyDict_New();
+
+    if (dict == NULL)
+	return NULL;
+    for (unsigned i = 0; i < sizeof(stages) / sizeof(*stages); ++i) {
+	double secs = hy_repo_get_load_time(self->repo, stages[i].which);
+	PyObject *value = PyFloat_FromDouble(secs);
+	if (value == NULL || PyDict_SetItemString(dict, stages[i].name, value)) {
+	    Py_XDECREF(value);
+	    Py_DECREF(dict);
+	    return NULL;
+	}
+	Py_DECREF(value);
+    }
+    return dict;
+}
+
 static PyGetSetDef repo_getsetters[] = {
     {"cost", (getter)get_int, (setter)set_int, "repository cost",
      (void *)&(IntGetSetter){hy_repo_get_cost,
@@ -176,6 +205,7 @@ static PyGetSetDef repo_getsetters[] = {
      (void *)HY_REPO_PRESTO_FN},
     {"updateinfo_fn", (getter)get_str, (setter)set_str, NULL,
      (void *)HY_REPO_UPDATEINFO_FN},
+    {"load_times", (getter)get_load_times, NULL, NULL, NULL},
     {NULL}			/* sentinel */
 };
 
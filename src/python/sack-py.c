@@ -403,13 +403,14 @@ static PyObject *
 load_system_repo(_SackObject *self, PyObject *args, PyObject *kwds)
 {
     char *kwlist[] = {"repo", "build_cache", "load_filelists", "load_presto",
-		      NULL};
+		      "incremental", NULL};
 
     HyRepo crepo = NULL;
-    int build_cache = 0, unused_1 = 0, unused_2 = 0;
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O&iii", kwlist,
+    int build_cache = 0, unused_1 = 0, unused_2 = 0, incremental = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O&iiii", kwlist,
 				     repo_converter, &crepo,
-				     &build_cache, &unused_1, &unused_2))
+				     &build_cache, &unused_1, &unused_2,
+				     &incremental))
 
 
 	return 0;
@@ -417,6 +418,8 @@ load_system_repo(_SackObject *self, PyObject *args, PyObject *kwds)
     int flags = 0;
     if (build_cache)
 	flags |= HY_BUILD_CACHE;
+    if (incremental)
+	flags |= HY_LOAD_INCREMENTAL;
 
     int ret = hy_sack_load_system_repo(self->sack, crepo, flags);
     if (ret == HY_E_CACHE_WRITE) {
@@ -431,14 +434,17 @@ static PyObject *
 load_repo(_SackObject *self, PyObject *args, PyObject *kwds)
 {
     char *kwlist[] = {"repo", "build_cache", "load_filelists", "load_presto",
-		      "load_updateinfo", NULL};
+		      "load_updateinfo", "load_text_index", "load_pipelined",
+		      NULL};
 
     HyRepo crepo = NULL;
     int build_cache = 0, load_filelists = 0, load_presto = 0, load_updateinfo = 0;
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|iiii", kwlist,
+    int load_text_index = 0, load_pipelined = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|iiiiii", kwlist,
 				     repo_converter, &crepo,
 				     &build_cache, &load_filelists,
-				     &load_presto, &load_updateinfo))
+				     &load_presto, &load_updateinfo,
+				     &load_text_index, &load_pipelined))
 	return 0;
 
     int flags = 0;
@@ -451,6 +457,10 @@ load_repo(_SackObject *self, PyObject *args, PyObject *kwds)
 	flags |= HY_LOAD_PRESTO;
     if (load_updateinfo)
         flags |= HY_LOAD_UPDATEINFO;
+    if (load_text_index)
+	flags |= HY_LOAD_TEXT_INDEX;
+    if (load_pipelined)
+	flags |= HY_LOAD_PIPELINED;
     Py_BEGIN_ALLOW_THREADS;
     if (hy_sack_load_repo(self->sack, crepo, flags))
 	ret = hy_get_errno();
@@ -33,10 +33,12 @@
 #include "iutil.h"
 #include "query_internal.h"
 #include "package_internal.h"
-#include "packagelist.h"
+#include "packagelist_internal.h"
 #include "packageset_internal.h"
 #include "reldep_internal.h"
+#include "repo_internal.h"
 #include "sack_internal.h"
+#include "textindex.h"
 
 #define BLOCK_SIZE 15
 
@@ -180,6 +182,15 @@ type2flags(int type, int keyname)
     }
 }
 
+/**
+ * Length of the part of a glob pattern before its first special character.
+ */
+static size_t
+glob_literal_prefix(const char *pattern)
+{
+    return strcspn(pattern, "*?[\\");
+}
+
 static int
 valid_filter_str(int keyname, int cmp_type)
 {
@@ -305,14 +316,113 @@ filter_dataiterator(HyQuery q, struct _Filter *f, Map *m)
     }
 }
 
+static void
+text_match(HyQuery q, Repo *repo, Id keyname, const char *match, int icase,
+	   Id p, Map *m)
+{
+    Solvable *s = pool_id2solvable(repo->pool, p);
+
+    if (!MAPTST(q->result, p) || s->repo != repo)
+	return;
+    const char *str = solvable_lookup_str(s, keyname);
+    if (str && (icase ? strcasestr(str, match) : strstr(str, match)))
+	MAPSET(m, p);
+}
+
+static void
+filter_text(HyQuery q, struct _Filter *f, Map *m)
+{
+    Pool *pool = sack_pool(q->sack);
+    Id keyname = di_keyname2id(f->keyname);
+    int flags = type2flags(f->cmp_type, f->keyname);
+    int icase = f->cmp_type & HY_ICASE;
+    Dataiterator di;
+    Queue offsets;
+    Repo *repo;
+    int i;
+
+    assert(f->match_type == _HY_STR);
+    queue_init(&offsets);
+    FOR_REPOS(i, repo) {
+	HyRepo hrepo = repo->appdata;
+	struct _TextIndex *idx = hrepo ? sack_text_index(q->sack, hrepo) : NULL;
+
+	for (int mi = 0; mi < f->nmatches; ++mi) {
+	    const char *match = f->matches[mi].str;
+
+	    if (idx == NULL || textindex_candidates(idx, match, &offsets)) {
+		dataiterator_init(&di, pool, repo, 0, keyname, match, flags);
+		while (dataiterator_step(&di))
+		    MAPSET(m, di.solvid);
+		dataiterator_free(&di);
+		continue;
+	    }
+	    for (int j = 0; j < offsets.count; ++j)
+		text_match(q, repo, keyname, match, icase,
+			   repo->start + offsets.elements[j], m);
+	    // solvables added after the main metadata, e.g. from updateinfo
+	    for (Id p = repo->start + idx->nsolvables; p < repo->end; ++p)
+		text_match(q, repo, keyname, match, icase, p, m);
+	}
+    }
+    queue_free(&offsets);
+}
+
+static void
+filter_id_index(HyQuery q, struct _Filter *f, Map *m)
+{
+    Pool *pool = sack_pool(q->sack);
+    const struct _IdIndex *idx =
+	sack_id_index(q->sack, di_keyname2id(f->keyname));
+
+    assert(f->match_type == _HY_STR);
+    for (int i = 0; i < f->nmatches; ++i) {
+	Id key = pool_str2id(pool, f->matches[i].str, 0);
+	const Id *solvables;
+	int n;
+
+	if (key == ID_NULL)
+	    continue;
+	n = id_index_lookup(idx, key, &solvables);
+	for (int j = 0; j < n; ++j)
+	    MAPSET(m, solvables[j]);
+    }
+}
+
+static void
+filter_name_glob(HyQuery q, struct _Filter *f, Map *m)
+{
+    Pool *pool = sack_pool(q->sack);
+    const struct _IdIndex *idx = sack_id_index(q->sack, SOLVABLE_NAME);
+    int fn_flags = (HY_ICASE & f->cmp_type) ? FNM_CASEFOLD : 0;
+
+    assert(f->match_type == _HY_STR);
+    for (int i = 0; i < f->nmatches; ++i) {
+	const char *match = f->matches[i].str;
+	size_t len = fn_flags ? 0 : glob_literal_prefix(match);
+	int lo, hi;
+
+	id_index_prefix(pool, idx, match, len, &lo, &hi);
+	for (int k = lo; k < hi; ++k) {
+	    Id name = idx->keys[idx->by_str[k]];
+	    const Id *solvables;
+
+	    if (fnmatch(match, pool_id2str(pool, name), fn_flags))
+		continue;
+	    int n = id_index_lookup(idx, name, &solvables);
+	    for (int j = 0; j < n; ++j)
+		MAPSET(m, solvables[j]);
+	}
+    }
+}
+
 static void
 filter_pkg(HyQuery q, struct _Filter *f, Map *m)
 {
     assert(f->nmatches == 1);
     assert(f->match_type == _HY_PKG);
 
-    map_free(m);
-    map_init_clone(m, packageset_get_map(f->matches[0].pset));
+    packageset_to_map(f->matches[0].pset, m);
 }
 
 static void
@@ -325,28 +435,37 @@ filter_all(HyQuery q, struct _Filter *f, Map *m)
     // just leaves m empty
 }
 
+static int
+match_cmp_type(int cmp, int cmp_type)
+{
+    return (cmp > 0 && cmp_type & HY_GT) ||
+	(cmp < 0 && cmp_type & HY_LT) ||
+	(cmp == 0 && cmp_type & HY_EQ);
+}
+
+static int
+vercmp_len(const char *a, int len, const char *b)
+{
+    return solv_vercmp(a, a + len, b, b + strlen(b));
+}
+
 static void
 filter_epoch(HyQuery q, struct _Filter *f, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
+    Id id;
 
     for (int mi = 0; mi < f->nmatches; ++mi) {
 	unsigned long epoch = f->matches[mi].num;
 
-	for (Id id = 1; id < pool->nsolvables; ++id) {
-            if (!MAPTST(q->result, id))
-                continue;
+	FOR_MAP_SET(q->result, id) {
 	    Solvable *s = pool_id2solvable(pool, id);
 	    if (s->evr == ID_EMPTY)
 		continue;
 
-	    const char *evr = pool_id2str(pool, s->evr);
-	    unsigned long pkg_epoch = pool_get_epoch(pool, evr);
-
-	    int cmp_type = f->cmp_type;
-	    if ((pkg_epoch > epoch && cmp_type & HY_GT) ||
-		(pkg_epoch < epoch && cmp_type & HY_LT) ||
-		(pkg_epoch == epoch && cmp_type & HY_EQ))
+	    unsigned long pkg_epoch = sack_evr_split(q->sack, s->evr)->epoch;
+	    int cmp = pkg_epoch > epoch ? 1 : (pkg_epoch < epoch ? -1 : 0);
+	    if (match_cmp_type(cmp, f->cmp_type))
 		MAPSET(m, id);
 	}
     }
@@ -356,19 +475,16 @@ static void
 filter_evr(HyQuery q, struct _Filter *f, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
+    Id id;
 
     for (int mi = 0; mi < f->nmatches; ++mi) {
 	Id match_evr = pool_str2id(pool, f->matches[mi].str, 1);
 
-	for (Id id = 1; id < pool->nsolvables; ++id) {
-            if (!MAPTST(q->result, id))
-                continue;
+	FOR_MAP_SET(q->result, id) {
 	    Solvable *s = pool_id2solvable(pool, id);
 	    int cmp = pool_evrcmp(pool, s->evr, match_evr, EVRCMP_COMPARE);
 
-	    if ((cmp > 0 && f->cmp_type & HY_GT) ||
-		(cmp < 0 && f->cmp_type & HY_LT) ||
-		(cmp == 0 && f->cmp_type & HY_EQ))
+	    if (match_cmp_type(cmp, f->cmp_type))
 		MAPSET(m, id);
 	}
     }
@@ -379,36 +495,32 @@ filter_version(HyQuery q, struct _Filter *f, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
     int cmp_type = f->cmp_type;
+    Id id;
 
     for (int mi = 0; mi < f->nmatches; ++mi) {
 	const char *match = f->matches[mi].str;
-	char *filter_vr = solv_dupjoin(match, "-0", NULL);
 
-	for (Id id = 1; id < pool->nsolvables; ++id) {
-            if (!MAPTST(q->result, id))
-                continue;
-	    char *e, *v, *r;
+	FOR_MAP_SET(q->result, id) {
 	    Solvable *s = pool_id2solvable(pool, id);
 	    if (s->evr == ID_EMPTY)
 		continue;
-	    const char *evr = pool_id2str(pool, s->evr);
-
-	    pool_split_evr(pool, evr, &e, &v, &r);
+	    const struct _EvrSplit *split = sack_evr_split(q->sack, s->evr);
+	    const char *version = pool_id2str(pool, s->evr) + split->version;
 
 	    if (cmp_type == HY_GLOB) {
+		char *v = pool_alloctmpspace(pool, split->version_len + 1);
+		memcpy(v, version, split->version_len);
+		v[split->version_len] = '\0';
 		if (fnmatch(match, v, 0))
 		    continue;
 		MAPSET(m, id);
+		continue;
 	    }
 
-	    char *vr = pool_tmpjoin(pool, v, "-0", NULL);
-	    int cmp = pool_evrcmp_str(pool, vr, filter_vr, EVRCMP_COMPARE);
-	    if ((cmp > 0 && cmp_type & HY_GT) ||
-		(cmp < 0 && cmp_type & HY_LT) ||
-		(cmp == 0 && cmp_type & HY_EQ))
+	    int cmp = vercmp_len(version, split->version_len, match);
+	    if (match_cmp_type(cmp, cmp_type))
 		MAPSET(m, id);
 	}
-	solv_free(filter_vr);
     }
 }
 
@@ -416,58 +528,74 @@ static void
 filter_release(HyQuery q, struct _Filter *f, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
+    Id id;
 
     for (int mi = 0; mi < f->nmatches; ++mi) {
-	char *filter_vr = solv_dupjoin("0-", f->matches[mi].str, NULL);
+	const char *match = f->matches[mi].str;
 
-	for (Id id = 1; id < pool->nsolvables; ++id) {
-            if (!MAPTST(q->result, id))
-                continue;
-	    char *e, *v, *r;
+	FOR_MAP_SET(q->result, id) {
 	    Solvable *s = pool_id2solvable(pool, id);
 	    if (s->evr == ID_EMPTY)
 		continue;
-	    const char *evr = pool_id2str(pool, s->evr);
-
-	    pool_split_evr(pool, evr, &e, &v, &r);
-	    char *vr = pool_tmpjoin(pool, "0-", r, NULL);
+	    const char *release = pool_id2str(pool, s->evr) +
+		sack_evr_split(q->sack, s->evr)->release;
 
-	    int cmp = pool_evrcmp_str(pool, vr, filter_vr, EVRCMP_COMPARE);
-
-	    if ((cmp > 0 && f->cmp_type & HY_GT) ||
-		(cmp < 0 && f->cmp_type & HY_LT) ||
-		(cmp == 0 && f->cmp_type & HY_EQ))
+	    int cmp = vercmp_len(release, strlen(release), match);
+	    if (match_cmp_type(cmp, f->cmp_type))
 		MAPSET(m, id);
 	}
-	solv_free(filter_vr);
     }
 }
 
+/* the name Id of a "name-version-release.arch.rpm" string, 0 if unknown */
+static Id
+sourcerpm_name(Pool *pool, const char *srcrpm)
+{
+    size_t len = strlen(srcrpm);
+
+    if (len < 4 || strcmp(srcrpm + len - 4, ".rpm"))
+	return 0;
+    len -= 4;
+    // drop the arch, the release and the version
+    for (int part = 0; part < 3; ++part) {
+	const char sep = part ? '-' : '.';
+	while (len && srcrpm[len - 1] != sep)
+	    --len;
+	if (len-- == 0)
+	    return 0;
+    }
+    return pool_strn2id(pool, srcrpm, len, 0);
+}
+
 static void
 filter_sourcerpm(HyQuery q, struct _Filter *f, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
+    const struct _IdIndex *idx = sack_source_index(q->sack);
 
     for (int mi = 0; mi < f->nmatches; ++mi) {
 	const char *match = f->matches[mi].str;
+	// without a source arch libsolv gives just the source name, ID_NULL
+	// holds the source names the index did not find in the pool
+	Id names[3] = { sourcerpm_name(pool, match), pool_str2id(pool, match, 0),
+			ID_NULL };
 
-	for (Id id = 1; id < pool->nsolvables; ++id) {
-            if (!MAPTST(q->result, id))
-                continue;
-	    Solvable *s = pool_id2solvable(pool, id);
+	for (int k = 0; k < 3; ++k) {
+	    const Id *cands;
+	    int n;
 
-	    const char *name = solvable_lookup_str(s, SOLVABLE_SOURCENAME);
-	    if (name == NULL)
-		name = pool_id2str(pool, s->name);
-	    if (!str_startswith(match, name)) // early check
+	    if (k < 2 && (!names[k] || (k && names[k] == names[0])))
 		continue;
-
-	    HyPackage pkg = package_create(q->sack, id);
-	    char *srcrpm = hy_package_get_sourcerpm(pkg);
-	    if (srcrpm && !strcmp(match, srcrpm))
-		MAPSET(m, id);
-	    solv_free(srcrpm);
-	    hy_package_free(pkg);
+	    n = id_index_lookup(idx, names[k], &cands);
+	    for (int j = 0; j < n; ++j) {
+		Id id = cands[j];
+		if (!MAPTST(q->result, id))
+		    continue;
+		const char *srcrpm =
+		    solvable_lookup_sourcepkg(pool_id2solvable(pool, id));
+		if (srcrpm && !strcmp(match, srcrpm))
+		    MAPSET(m, id);
+	    }
 	}
     }
 }
@@ -475,33 +603,20 @@ filter_sourcerpm(HyQuery q, struct _Filter *f, Map *m)
 static void
 filter_obsoletes(HyQuery q, struct _Filter *f, Map *m)
 {
-    Pool *pool = sack_pool(q->sack);
-    int obsprovides = pool_get_flag(pool, POOL_FLAG_OBSOLETEUSESPROVIDES);
-    Map *target;
+    const struct _IdIndex *idx = sack_obsoletes_index(q->sack);
+    HyPackageSet target;
 
     assert(f->match_type == _HY_PKG);
     assert(f->nmatches == 1);
-    target = packageset_get_map(f->matches[0].pset);
-    sack_make_provides_ready(q->sack);
-    for (Id p = 1; p < pool->nsolvables; ++p) {
-        if (!MAPTST(q->result, p))
-            continue;
-	Solvable *s = pool_id2solvable(pool, p);
-	if (!s->repo)
+    target = f->matches[0].pset;
+    // few solvables are ever obsoleted, walk those rather than the target
+    for (int i = 0; i < idx->nkeys; ++i) {
+	if (!packageset_has_id(target, idx->keys[i]))
 	    continue;
-	for (Id *r_id = s->repo->idarraydata + s->obsoletes; *r_id; ++r_id) {
-	    Id r, rr;
-
-	    FOR_PROVIDES(r, rr, *r_id) {
-		if (!MAPTST(target, r))
-		    continue;
-		assert(r != SYSTEMSOLVABLE);
-		Solvable *so = pool_id2solvable(pool, r);
-		if (!obsprovides && !pool_match_nevr(pool, so, *r_id))
-		    continue; /* only matching pkg names */
+	for (int j = idx->start[i]; j < idx->start[i + 1]; ++j) {
+	    Id p = idx->solvables[j];
+	    if (MAPTST(q->result, p))
 		MAPSET(m, p);
-		break;
-	    }
 	}
     }
 }
@@ -520,6 +635,32 @@ filter_provides_reldep(HyQuery q, struct _Filter *f, Map *m)
     }
 }
 
+/* the name every dependency matching dep must mention, 0 if there is none */
+static Id
+reldep_index_name(Pool *pool, Id dep)
+{
+    while (ISRELDEP(dep)) {
+	Reldep *rd = GETRELDEP(pool, dep);
+	if (rd->flags >= 8 && rd->flags != REL_ARCH)
+	    return 0;
+	dep = rd->name;
+    }
+    return dep;
+}
+
+static int
+solvable_matches_rco(Pool *pool, Id s_id, Id rco_key, Id r_id, Queue *rco)
+{
+    Solvable *s = pool_id2solvable(pool, s_id);
+
+    queue_empty(rco);
+    solvable_lookup_idarray(s, rco_key, rco);
+    for (int j = 0; j < rco->count; ++j)
+	if (pool_match_dep(pool, r_id, rco->elements[j]))
+	    return 1;
+    return 0;
+}
+
 static void
 filter_rco_reldep(HyQuery q, struct _Filter *f, Map *m)
 {
@@ -527,29 +668,30 @@ filter_rco_reldep(HyQuery q, struct _Filter *f, Map *m)
 
     Pool *pool = sack_pool(q->sack);
     Id rco_key = reldep_keyname2id(f->keyname);
+    const struct _IdIndex *idx = sack_dep_index(q->sack, rco_key);
     Queue rco;
+    Id s_id;
 
     queue_init(&rco);
     for (int i = 0; i < f->nmatches; ++i) {
 	Id r_id = reldep_id(f->matches[i].reldep);
-
-	for (Id s_id = 1; s_id < pool->nsolvables; ++s_id) {
-            if (!MAPTST(q->result, s_id))
-                continue;
-
-	    Solvable *s = pool_id2solvable(pool, s_id);
-
-	    queue_empty(&rco);
-	    solvable_lookup_idarray(s, rco_key, &rco);
-	    for (int j = 0; j < rco.count; ++j) {
-		Id r_id2 = rco.elements[j];
-
-		if (pool_match_dep(pool, r_id, r_id2)) {
+	Id name = reldep_index_name(pool, r_id);
+
+	if (name) {
+	    // only the solvables with a dependency on the name can match
+	    const Id *cands;
+	    int n = id_index_lookup(idx, name, &cands);
+	    for (int j = 0; j < n; ++j) {
+		s_id = cands[j];
+		if (MAPTST(q->result, s_id) && !MAPTST(m, s_id) &&
+		    solvable_matches_rco(pool, s_id, rco_key, r_id, &rco))
 		    MAPSET(m, s_id);
-		    break;
-		}
 	    }
+	    continue;
 	}
+	FOR_MAP_SET(q->result, s_id)
+	    if (solvable_matches_rco(pool, s_id, rco_key, r_id, &rco))
+		MAPSET(m, s_id);
     }
     queue_free(&rco);
 }
@@ -558,34 +700,25 @@ static void
 filter_reponame(HyQuery q, struct _Filter *f, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
-    int i;
-    Solvable *s;
     Repo *r;
-    Id id, ourids[pool->nrepos];
+    Id id, p;
 
-    for (id = 0; id < pool->nrepos; ++id)
-	ourids[id] = 0;
+    assert((f->cmp_type & ~HY_COMPARISON_FLAG_MASK) == HY_EQ);
     FOR_REPOS(id, r) {
-	for (i = 0; i < f->nmatches; i++) {
-	    if (!strcmp(r->name, f->matches[i].str)) {
-		ourids[id] = 1;
+	int i;
+	for (i = 0; i < f->nmatches; i++)
+	    if (!strcmp(r->name, f->matches[i].str))
 		break;
-	    }
-	}
-    }
-
-    for (i = 1; i < pool->nsolvables; ++i) {
-        if (!MAPTST(q->result, i))
-            continue;
-	s = pool_id2solvable(pool, i);
-	switch (f->cmp_type & ~HY_COMPARISON_FLAG_MASK) {
-	case HY_EQ:
-	    if (s->repo && ourids[s->repo->repoid])
-		MAPSET(m, i);
-	    break;
-	default:
-	    assert(0);
+	if (i == f->nmatches)
+	    continue;
+	// a repo usually owns all of its range, only look closer when not
+	if (r->end - r->start == r->nsolvables) {
+	    map_set_range(m, r->start, r->end);
+	    continue;
 	}
+	for (p = r->start; p < r->end; ++p)
+	    if (pool->solvables[p].repo == r)
+		MAPSET(m, p);
     }
 }
 
@@ -593,13 +726,12 @@ static void
 filter_location(HyQuery q, struct _Filter *f, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
+    Id id;
 
     for (int mi = 0; mi < f->nmatches; ++mi) {
 	const char *match = f->matches[mi].str;
 
-	for (Id id = 1; id < pool->nsolvables; ++id) {
-            if (!MAPTST(q->result, id))
-                continue;
+	FOR_MAP_SET(q->result, id) {
 	    Solvable *s = pool_id2solvable(pool, id);
 
 	    const char *location = solvable_get_location(s, NULL);
@@ -612,23 +744,65 @@ filter_location(HyQuery q, struct _Filter *f, Map *m)
 }
 
 static void
-filter_nevra(HyQuery q, struct _Filter *f, Map *m)
+nevra_match(HyQuery q, struct _Filter *f, Id id, Map *m)
 {
     Pool *pool = sack_pool(q->sack);
     int fn_flags = (HY_ICASE & f->cmp_type) ? FNM_CASEFOLD : 0;
     char *nevra_pattern = f->matches[0].str;
+    Solvable* s = pool_id2solvable(pool, id);
+    const char* nevra = pool_solvable2str(pool, s);
 
-    for (Id id = 1; id < pool->nsolvables; ++id) {
-        if (!MAPTST(q->result, id))
-            continue;
-	Solvable* s = pool_id2solvable(pool, id);
-	const char* nevra = pool_solvable2str(pool, s);
-	if (!(HY_GLOB & f->cmp_type)) {
-	    if (strcmp(nevra_pattern, nevra) == 0)
-		MAPSET(m, id);
-	} else if (fnmatch(nevra_pattern, nevra, fn_flags) == 0) {
+    if (!(HY_GLOB & f->cmp_type)) {
+	if (strcmp(nevra_pattern, nevra) == 0)
 	    MAPSET(m, id);
-	}
+    } else if (fnmatch(nevra_pattern, nevra, fn_flags) == 0) {
+	MAPSET(m, id);
+    }
+}
+
+static void
+nevra_match_name(HyQuery q, struct _Filter *f, const struct _IdIndex *idx,
+		 Id name, Map *m)
+{
+    const Id *solvables;
+    int n = id_index_lookup(idx, name, &solvables);
+
+    for (int i = 0; i < n; ++i)
+	if (MAPTST(q->result, solvables[i]))
+	    nevra_match(q, f, solvables[i], m);
+}
+
+static void
+filter_nevra(HyQuery q, struct _Filter *f, Map *m)
+{
+    Pool *pool = sack_pool(q->sack);
+    char *nevra_pattern = f->matches[0].str;
+    size_t len = 0;
+    Id id;
+
+    if (!(HY_ICASE & f->cmp_type))
+	len = (HY_GLOB & f->cmp_type) ? glob_literal_prefix(nevra_pattern) :
+	    strlen(nevra_pattern);
+    if (len == 0) {
+	FOR_MAP_SET(q->result, id)
+	    nevra_match(q, f, id, m);
+	return;
+    }
+
+    /* the name either starts with the literal prefix, or it is shorter and the
+       prefix continues with '-' after it */
+    const struct _IdIndex *idx = sack_id_index(q->sack, SOLVABLE_NAME);
+    int lo, hi;
+
+    id_index_prefix(pool, idx, nevra_pattern, len, &lo, &hi);
+    for (int i = lo; i < hi; ++i)
+	nevra_match_name(q, f, idx, idx->keys[idx->by_str[i]], m);
+    for (const char *dash = nevra_pattern;
+	 (dash = memchr(dash, '-', nevra_pattern + len - dash)) != NULL;
+	 ++dash) {
+	Id name = pool_strn2id(pool, nevra_pattern, dash - nevra_pattern, 0);
+	if (name != ID_NULL)
+	    nevra_match_name(q, f, idx, name, m);
     }
 }
 
@@ -637,22 +811,20 @@ filter_updown(HyQuery q, int downgrade, Map *res)
 {
     HySack sack = q->sack;
     Pool *pool = sack_pool(sack);
-    int i;
+    Id id;
     Map m;
 
     assert(pool->installed);
     sack_make_provides_ready(q->sack);
     map_init(&m, pool->nsolvables);
-    for (i = 1; i < pool->nsolvables; ++i) {
-	if (!MAPTST(res, i))
-	    continue;
-	Solvable *s = pool_id2solvable(pool, i);
+    FOR_MAP_SET(res, id) {
+	Solvable *s = pool_id2solvable(pool, id);
 	if (s->repo == pool->installed)
 	    continue;
-	if (downgrade && what_downgrades(pool, i) > 0)
-	    MAPSET(&m, i);
-	else if (!downgrade && what_upgrades(pool, i) > 0)
-	    MAPSET(&m, i);
+	if (downgrade && what_downgrades(sack, id) > 0)
+	    MAPSET(&m, id);
+	else if (!downgrade && what_upgrades(sack, id) > 0)
+	    MAPSET(&m, id);
     }
 
     map_and(res, &m);
@@ -675,8 +847,8 @@ filter_updown_able(HyQuery q, int downgradable, Map *res)
 	if (s->repo == pool->installed)
 	    continue;
 
-	what = downgradable ? what_downgrades(pool, p) :
-			      what_upgrades(pool, p);
+	what = downgradable ? what_downgrades(q->sack, p) :
+			      what_upgrades(q->sack, p);
 	if (what != 0 && map_tst(res, what))
 	    map_set(&m, what);
     }
@@ -685,82 +857,31 @@ filter_updown_able(HyQuery q, int downgradable, Map *res)
     map_free(&m);
 }
 
-static int
-filter_latest_sortcmp(const void *ap, const void *bp, void *dp)
-{
-    Pool *pool = dp;
-    Solvable *sa = pool->solvables + *(Id *)ap;
-    Solvable *sb = pool->solvables + *(Id *)ap;
-    int r;
-    r = sa->name - sb->name;
-    if (r)
-        return r;
-    return *(Id *)ap - *(Id *)bp;
-}
-
-static int
-filter_latest_sortcmp_byarch(const void *ap, const void *bp, void *dp)
-{
-    Pool *pool = dp;
-    Solvable *sa = pool->solvables + *(Id *)ap;
-    Solvable *sb = pool->solvables + *(Id *)bp;
-    int r;
-    r = sa->name - sb->name;
-    if (r)
-        return r;
-    r = sa->arch - sb->arch;
-    if (r)
-        return r;
-    return *(Id *)ap - *(Id *)bp;
-}
-
 static void
 filter_latest(HyQuery q, Map *res)
 {
-    Pool *pool = sack_pool(q->sack);
-    Queue samename;
-
-    queue_init(&samename);
-    for (int i = 1; i < pool->nsolvables; ++i)
-        if (MAPTST(res, i))
-            queue_push(&samename, i);
+    const struct _EvrRank *idx = sack_evr_rank(q->sack);
+    const Id *group;
+    Id *best, id;
 
-    if (samename.count < 2) {
-	queue_free(&samename);
-        return;
+    if (q->latest_per_arch) {
+	group = idx->namearch_group;
+	best = solv_calloc(idx->nnamearch_groups, sizeof(Id));
+    } else {
+	group = idx->name_group;
+	best = solv_calloc(idx->nname_groups, sizeof(Id));
     }
 
-    if (q->latest_per_arch)
-        solv_sort(samename.elements, samename.count, sizeof(Id),
-		  filter_latest_sortcmp_byarch, pool);
-    else
-        solv_sort(samename.elements, samename.count, sizeof(Id),
-		  filter_latest_sortcmp, pool);
-
-    Solvable *considered, *highest = 0;
-    Id hp = 0;
-
-    for (int i = 0; i < samename.count; ++i) {
-        Id p = samename.elements[i];
-        considered = pool->solvables + p;
-        if (!highest || highest->name != considered->name ||
-            (q->latest_per_arch && highest->arch != considered->arch)) {
-            /* start of a new block */
-            hp = p;
-            highest = considered;
-            continue;
-        }
-        if (pool_evrcmp(pool,highest->evr, considered->evr, EVRCMP_COMPARE) < 0) {
-            /* new highest found */
-            MAPCLR(res, hp);
-            hp = p;
-            highest = considered;
-        } else {
-            /* note this is taken also for the same version case */
-            MAPCLR(res, p);
-        }
+    // of the same versions the lowest Id wins
+    FOR_MAP_SET(res, id) {
+	Id *b = best + group[id];
+	if (*b == 0 || idx->rank[id] > idx->rank[*b])
+	    *b = id;
     }
-    queue_free(&samename);
+    FOR_MAP_SET(res, id)
+	if (best[group[id]] != id)
+	    MAPCLR(res, id);
+    solv_free(best);
 }
 
 static void
@@ -781,42 +902,323 @@ clear_filters(HyQuery q)
     q->latest_per_arch = 0;
 }
 
+/* Relative costs of evaluating one match of a filter, cheapest first: 1 is a
+   lookup in a ready libsolv index, above it come walks over index hits, tests
+   on every solvable of the result, repodata lookups and full text scans. */
+#define COST_TRIVIAL      0.1    /* all packages, a package set */
+#define COST_REPO_RANGE   0.5    /* solvable ranges of the repos */
+#define COST_INDEX        1.0    /* whatprovides, the name and arch index */
+#define COST_INDEX_WALK   2.0    /* index hits filtered further */
+#define COST_DEP_ARRAYS   5.0    /* dependency arrays, dataiterator */
+#define COST_RESULT_TEST  20.0   /* cheap test on each solvable */
+#define COST_REPODATA     50.0   /* repodata lookup on each solvable */
+#define COST_FILELIST     100.0
+#define COST_TEXT         200.0  /* summary, description, url */
+
+/* Expected fraction of the pool one match of a filter lets through, narrowest
+   first. */
+#define SEL_UNIQUE        0.001  /* exact names, nevras, files */
+#define SEL_DEP           0.01
+#define SEL_PATTERN       0.05   /* globs, substrings, one version */
+#define SEL_ARCH          0.3    /* also a repo */
+#define SEL_RANGE         0.5    /* evr comparisons */
+#define SEL_EPOCH         0.9    /* nearly everything has epoch 0 */
+
+/**
+ * Estimate the work needed to evaluate filter f and the fraction of the
+ * candidates it lets through.
+ */
+static void
+filter_estimate(HyQuery q, struct _Filter *f, double *cost, double *selectivity)
+{
+    const int nmatches = f->nmatches > 0 ? f->nmatches : 1;
+    const int type = f->cmp_type & ~HY_COMPARISON_FLAG_MASK;
+    double c, sel;
+
+    switch (f->keyname) {
+    case HY_PKG_ALL:
+	c = COST_TRIVIAL;
+	sel = 0.0;
+	break;
+    case HY_PKG: {
+	Pool *pool = sack_pool(q->sack);
+	unsigned count = hy_packageset_count(f->matches[0].pset);
+	c = COST_TRIVIAL;
+	sel = (double)count / (pool->nsolvables ? pool->nsolvables : 1);
+	break;
+    }
+    case HY_PKG_PROVIDES:
+	c = COST_INDEX * nmatches;
+	sel = SEL_DEP * nmatches;
+	break;
+    case HY_PKG_NAME:
+    case HY_PKG_ARCH:
+	/* exact matches and name globs go through an index, the rest is a
+	   dataiterator over solvable attributes of the whole pool */
+	if ((f->cmp_type & ~HY_NOT) == HY_EQ)
+	    c = COST_INDEX * nmatches;
+	else if (f->keyname == HY_PKG_NAME && type == HY_GLOB)
+	    c = COST_INDEX_WALK * nmatches;
+	else
+	    c = COST_DEP_ARRAYS * nmatches;
+	if (f->keyname == HY_PKG_ARCH)
+	    sel = SEL_ARCH * nmatches;
+	else if (type == HY_EQ)
+	    sel = SEL_UNIQUE * nmatches;
+	else
+	    sel = SEL_PATTERN * nmatches;
+	break;
+    case HY_PKG_EPOCH:
+    case HY_PKG_EVR:
+    case HY_PKG_VERSION:
+    case HY_PKG_RELEASE:
+    case HY_PKG_NEVRA:
+	c = COST_RESULT_TEST * nmatches;
+	if (f->keyname == HY_PKG_NEVRA && !(f->cmp_type & HY_ICASE) &&
+	    (type != HY_GLOB || glob_literal_prefix(f->matches[0].str)))
+	    c = COST_INDEX_WALK; /* narrowed down by the name index */
+	if (f->keyname == HY_PKG_NEVRA)
+	    sel = type == HY_GLOB ? SEL_PATTERN : SEL_UNIQUE;
+	else if (type == HY_EQ)
+	    sel = f->keyname == HY_PKG_EPOCH ? SEL_EPOCH : SEL_PATTERN * nmatches;
+	else
+	    sel = SEL_RANGE;
+	break;
+    case HY_PKG_REPONAME:
+	c = COST_REPO_RANGE * nmatches;
+	sel = SEL_ARCH * nmatches;
+	break;
+    case HY_PKG_SOURCERPM:
+	/* repodata lookups for the solvables of the source name */
+	c = COST_INDEX_WALK * nmatches;
+	sel = SEL_UNIQUE * nmatches;
+	break;
+    case HY_PKG_LOCATION:
+	c = COST_REPODATA * nmatches;
+	sel = SEL_UNIQUE * nmatches;
+	break;
+    case HY_PKG_CONFLICTS:
+    case HY_PKG_ENHANCES:
+    case HY_PKG_OBSOLETES:
+    case HY_PKG_RECOMMENDS:
+    case HY_PKG_REQUIRES:
+    case HY_PKG_SUGGESTS:
+    case HY_PKG_SUPPLEMENTS:
+	/* dependency arrays of the solvables the dependency index yields */
+	c = COST_DEP_ARRAYS * nmatches;
+	sel = SEL_DEP * nmatches;
+	break;
+    case HY_PKG_FILE:
+	c = COST_FILELIST * nmatches;
+	sel = (type == HY_EQ ? SEL_UNIQUE : SEL_PATTERN) * nmatches;
+	break;
+    default:
+	c = COST_TEXT * nmatches;
+	sel = SEL_PATTERN * nmatches;
+	break;
+    }
+    if (sel > 1.0)
+	sel = 1.0;
+    if (f->cmp_type & HY_NOT)
+	sel = 1.0 - sel;
+    *cost = c;
+    *selectivity = sel;
+}
+
+struct _FilterPlan {
+    int index;
+    double rank;
+};
+
+static int
+filter_plan_cmp(const void *ap, const void *bp, void *dp)
+{
+    const struct _FilterPlan *a = ap;
+    const struct _FilterPlan *b = bp;
+
+    if (a->rank < b->rank)
+	return -1;
+    if (a->rank > b->rank)
+	return 1;
+    return a->index - b->index;
+}
+
+/**
+ * Order the filters of q so the ones that are cheap and narrow the result down
+ * the most get evaluated first.
+ *
+ * All filters are intersections with (or subtractions from) the result so any
+ * order gives the same outcome. Uses the classic predicate ordering: ascending
+ * by cost / (1 - selectivity).
+ */
+static int *
+plan_filters(HyQuery q)
+{
+    struct _FilterPlan *plan = solv_calloc(q->nfilters, sizeof(*plan));
+    int *order = solv_calloc(q->nfilters, sizeof(*order));
+
+    for (int i = 0; i < q->nfilters; ++i) {
+	double cost, sel;
+
+	filter_estimate(q, q->filters + i, &cost, &sel);
+	plan[i].index = i;
+	plan[i].rank = cost / (1.0 - sel + 0.001);
+    }
+    solv_sort(plan, q->nfilters, sizeof(*plan), filter_plan_cmp, NULL);
+    for (int i = 0; i < q->nfilters; ++i)
+	order[i] = plan[i].index;
+    solv_free(plan);
+    return order;
+}
+
+static int
+map_is_empty(Map *m)
+{
+    return map_next(m, -1) < 0;
+}
+
+/**
+ * Intersect result with m, or subtract m from it if subtract is set.
+ *
+ * Returns nonzero if anything is left in result, found in the same pass so the
+ * caller does not have to scan the map again.
+ */
+static int
+result_merge(Map *result, const Map *m, int subtract)
+{
+    unsigned char *ti = result->map;
+    const unsigned char *si = m->map;
+    unsigned char any = 0;
+
+    assert(result->size == m->size);
+    for (int i = 0; i < result->size; ++i) {
+	ti[i] &= subtract ? ~si[i] : si[i];
+	any |= ti[i];
+    }
+    return any != 0;
+}
+
 static void
 init_result(HyQuery q)
 {
-    Pool *pool = sack_pool(q->sack);
-    Id solvid;
+    const Map *base = sack_query_base(q->sack, q->flags & HY_IGNORE_EXCLUDES);
 
     q->result = solv_calloc(1, sizeof(Map));
-    map_init(q->result, pool->nsolvables);
-    FOR_PKG_SOLVABLES(solvid)
-        map_set(q->result, solvid);
-    if (!(q->flags & HY_IGNORE_EXCLUDES)) {
-        sack_recompute_considered(q->sack);
-        if (pool->considered)
-            map_and(q->result, pool->considered);
-    }
+    map_init_clone(q->result, base);
+}
 
-    // make sure the odd bits are cleared:
-    unsigned total_bits = q->result->size << 3;
-    for (int i = pool->nsolvables; i < total_bits; ++i)
-        MAPCLR(q->result, i);
+struct _FilterSig {
+    char *buf;
+    size_t len;
+};
+
+static void
+sig_append(struct _FilterSig *sig, const void *data, size_t n)
+{
+    sig->buf = solv_extend(sig->buf, sig->len, n, 1, 255);
+    memcpy(sig->buf + sig->len, data, n);
+    sig->len += n;
+}
+
+static int
+filter_sig_cmp(const void *ap, const void *bp, void *dp)
+{
+    const struct _FilterSig *a = ap, *b = bp;
+
+    if (a->len != b->len)
+	return a->len < b->len ? -1 : 1;
+    return memcmp(a->buf, b->buf, a->len);
+}
+
+/**
+ * Serialize the filters and flags of q so that queries with the same result
+ * get the same signature regardless of the order their filters were added in.
+ *
+ * Returns NULL for queries that can not be cached: those filtering by package
+ * sets and those applied on top of an earlier result.
+ */
+static char *
+query_signature(HyQuery q, size_t *lenp)
+{
+    struct _FilterSig *sigs, all = { NULL, 0 };
+    int i;
+
+    if (q->result)
+	return NULL;
+    for (i = 0; i < q->nfilters; ++i)
+	if (q->filters[i].match_type == _HY_PKG)
+	    return NULL;
+
+    sigs = solv_calloc(q->nfilters + 1, sizeof(*sigs));
+    for (i = 0; i < q->nfilters; ++i) {
+	struct _Filter *f = q->filters + i;
+	int head[] = { f->keyname, f->cmp_type, f->match_type, f->nmatches };
+
+	sig_append(sigs + i, head, sizeof(head));
+	for (int mi = 0; mi < f->nmatches; ++mi)
+	    switch (f->match_type) {
+	    case _HY_NUM:
+		sig_append(sigs + i, &f->matches[mi].num, sizeof(int));
+		break;
+	    case _HY_RELDEP: {
+		Id r_id = reldep_id(f->matches[mi].reldep);
+		sig_append(sigs + i, &r_id, sizeof(r_id));
+		break;
+	    }
+	    case _HY_STR: {
+		const char *str = f->matches[mi].str;
+		sig_append(sigs + i, str, strlen(str) + 1);
+		break;
+	    }
+	    default:
+		assert(0);
+	    }
+    }
+    solv_sort(sigs, q->nfilters, sizeof(*sigs), filter_sig_cmp, NULL);
+
+    int flags[] = { q->flags, q->downgradable, q->downgrades, q->updatable,
+		    q->updates, q->latest, q->latest_per_arch };
+    sig_append(&all, flags, sizeof(flags));
+    for (i = 0; i < q->nfilters; ++i) {
+	sig_append(&all, &sigs[i].len, sizeof(sigs[i].len));
+	sig_append(&all, sigs[i].buf, sigs[i].len);
+	solv_free(sigs[i].buf);
+    }
+    solv_free(sigs);
+    *lenp = all.len;
+    return all.buf;
 }
 
 void
 hy_query_apply(HyQuery q)
 {
     Pool *pool = sack_pool(q->sack);
+    size_t siglen = 0;
+    char *sig;
     Map m;
 
     if (q->applied)
         return;
+    sig = query_signature(q, &siglen);
+    if (sig) {
+	Map cached;
+	if (sack_query_cache_get(q->sack, sig, siglen, &cached)) {
+	    q->result = solv_calloc(1, sizeof(Map));
+	    *q->result = cached;
+	    solv_free(sig);
+	    q->applied = 1;
+	    clear_filters(q);
+	    return;
+	}
+    }
     if (!q->result)
         init_result(q);
     map_init(&m, pool->nsolvables);
     assert(m.size == q->result->size);
-    for (int i = 0; i < q->nfilters; ++i) {
-	struct _Filter *f = q->filters + i;
+    int *order = plan_filters(q);
+    int nonempty = !map_is_empty(q->result);
+    for (int i = 0; i < q->nfilters && nonempty; ++i) {
+	struct _Filter *f = q->filters + order[i];
 
 	map_empty(&m);
 	switch (f->keyname) {
@@ -873,15 +1275,33 @@ hy_query_apply(HyQuery q)
 	case HY_PKG_LOCATION:
 	    filter_location(q, f, &m);
 	    break;
+	case HY_PKG_NAME:
+	case HY_PKG_ARCH:
+	    if ((f->cmp_type & ~HY_NOT) == HY_EQ)
+		filter_id_index(q, f, &m);
+	    else if (f->keyname == HY_PKG_NAME &&
+		     (f->cmp_type & ~HY_COMPARISON_FLAG_MASK) == HY_GLOB)
+		filter_name_glob(q, f, &m);
+	    else
+		filter_dataiterator(q, f, &m);
+	    break;
+	case HY_PKG_DESCRIPTION:
+	case HY_PKG_SUMMARY:
+	case HY_PKG_URL:
+	    if ((f->cmp_type & ~HY_COMPARISON_FLAG_MASK) == HY_SUBSTR)
+		filter_text(q, f, &m);
+	    else
+		filter_dataiterator(q, f, &m);
+	    break;
 	default:
 	    filter_dataiterator(q, f, &m);
 	}
-	if (f->cmp_type & HY_NOT)
-	    map_subtract(q->result, &m);
-	else
-	    map_and(q->result, &m);
+	nonempty = result_merge(q->result, &m, f->cmp_type & HY_NOT);
     }
     map_free(&m);
+    solv_free(order);
+    if (!nonempty)
+	goto done;
     if (q->downgradable)
 	filter_updown_able(q, 1, q->result);
     if (q->downgrades)
@@ -893,6 +1313,11 @@ hy_query_apply(HyQuery q)
     if (q->latest)
 	filter_latest(q, q->result);
 
+ done:
+    if (sig) {
+	sack_query_cache_put(q->sack, sig, siglen, q->result);
+	solv_free(sig);
+    }
     q->applied = 1;
     clear_filters(q);
 }
@@ -1258,14 +1683,8 @@ hy_query_filter_latest(HyQuery q, int val)
 HyPackageList
 hy_query_run(HyQuery q)
 {
-    Pool *pool = sack_pool(q->sack);
-    HyPackageList plist = hy_packagelist_create();
-
     hy_query_apply(q);
-    for (int i = 1; i < pool->nsolvables; ++i)
-	if (MAPTST(q->result, i))
-	    hy_packagelist_push(plist, package_create(q->sack, i));
-    return plist;
+    return packagelist_from_map(q->sack, q->result);
 }
 
 HyPackageSet
@@ -1275,12 +1694,24 @@ hy_query_run_set(HyQuery q)
     return packageset_from_bitmap(q->sack, q->result);
 }
 
+/**
+ * Apply the query and return the number of matching packages.
+ *
+ * Nothing is allocated for the result, use this when only the size is needed.
+ */
+int
+hy_query_count(HyQuery q)
+{
+    hy_query_apply(q);
+    return map_count(q->result);
+}
+
 void
 hy_query_union(HyQuery q, HyQuery other)
 {
     hy_query_apply(q);
     hy_query_apply(other);
-    map_or(q->result, other->result);
+    map_combine(q->result, other->result, MAP_OP_OR);
 }
 
 void
@@ -1288,7 +1719,7 @@ hy_query_intersection(HyQuery q, HyQuery other)
 {
     hy_query_apply(q);
     hy_query_apply(other);
-    map_and(q->result, other->result);
+    map_combine(q->result, other->result, MAP_OP_AND);
 }
 
 void
@@ -1296,5 +1727,13 @@ hy_query_difference(HyQuery q, HyQuery other)
 {
     hy_query_apply(q);
     hy_query_apply(other);
-    map_subtract(q->result, other->result);
+    map_combine(q->result, other->result, MAP_OP_SUBTRACT);
+}
+
+void
+hy_query_symmetric_difference(HyQuery q, HyQuery other)
+{
+    hy_query_apply(q);
+    hy_query_apply(other);
+    map_combine(q->result, other->result, MAP_OP_XOR);
 }
@@ -19,6 +19,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 // libsolv
 #include <solv/util.h>
@@ -42,6 +43,27 @@ repo_finalize_init(HyRepo hrepo, Repo *repo)
     hrepo->libsolv_repo = repo;
 }
 
+/* forget a previous load so that hrepo can be loaded again */
+void
+repo_reset_load_state(HyRepo hrepo)
+{
+    hrepo->libsolv_repo = NULL;
+    hrepo->needs_internalizing = 0;
+    hrepo->state_main = _HY_NEW;
+    hrepo->state_filelists = _HY_NEW;
+    hrepo->state_presto = _HY_NEW;
+    hrepo->state_updateinfo = _HY_NEW;
+    hrepo->filenames_repodata = 0;
+    hrepo->presto_repodata = 0;
+    hrepo->updateinfo_repodata = 0;
+    hrepo->main_nsolvables = 0;
+    hrepo->main_nrepodata = 0;
+    hrepo->main_end = 0;
+    textindex_free(hrepo->text_index);
+    hrepo->text_index = NULL;
+    memset(&hrepo->load_times, 0, sizeof(hrepo->load_times));
+}
+
 void
 repo_internalize_all_trigger(Pool *pool)
 {
@@ -214,6 +236,30 @@ hy_repo_get_string(HyRepo repo, int which)
     return NULL;
 }
 
+/**
+ * Returns the seconds spent in one stage of loading the repo's metadata, the
+ * stall stages are the time one was waiting for the other.
+ *
+ * Only the metadata loaded with HY_LOAD_PIPELINED is measured.
+ */
+double
+hy_repo_get_load_time(HyRepo repo, int which)
+{
+    switch (which) {
+    case HY_REPO_TIME_DECOMPRESS:
+	return repo->load_times.decompress;
+    case HY_REPO_TIME_DECOMPRESS_STALL:
+	return repo->load_times.decompress_stall;
+    case HY_REPO_TIME_PARSE:
+	return repo->load_times.parse;
+    case HY_REPO_TIME_PARSE_STALL:
+	return repo->load_times.parse_stall;
+    default:
+	assert(0);
+    }
+    return 0;
+}
+
 void
 hy_repo_free(HyRepo repo)
 {
@@ -228,5 +274,6 @@ hy_repo_free(HyRepo repo)
     solv_free(repo->filelists_fn);
     solv_free(repo->presto_fn);
     solv_free(repo->updateinfo_fn);
+    textindex_free(repo->text_index);
     solv_free(repo);
 }
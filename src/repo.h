@@ -37,6 +37,14 @@ enum _hy_repo_param_e {
     HY_REPO_UPDATEINFO_FN = 5
 };
 
+/* stages of loading with HY_LOAD_PIPELINED */
+enum _hy_repo_load_time_e {
+    HY_REPO_TIME_DECOMPRESS = 0,
+    HY_REPO_TIME_DECOMPRESS_STALL = 1,
+    HY_REPO_TIME_PARSE = 2,
+    HY_REPO_TIME_PARSE_STALL = 3
+};
+
 HyRepo hy_repo_create(const char *name);
 int hy_repo_get_cost(HyRepo repo);
 int hy_repo_get_priority(HyRepo repo);
@@ -44,6 +52,7 @@ void hy_repo_set_cost(HyRepo repo, int value);
 void hy_repo_set_priority(HyRepo repo, int value);
 void hy_repo_set_string(HyRepo repo, int which, const char *str_val);
 const char *hy_repo_get_string(HyRepo repo, int which);
+double hy_repo_get_load_time(HyRepo repo, int which);
 void hy_repo_free(HyRepo repo);
 
 #ifdef __cplusplus
@@ -27,6 +27,8 @@
 // hawkey
 #include "iutil.h"
 #include "repo.h"
+#include "textindex.h"
+#include "xpipe.h"
 
 enum _hy_repo_state {
     _HY_NEW,
@@ -60,6 +62,8 @@ struct _HyRepo {
     int main_nsolvables;
     int main_nrepodata;
     int main_end;
+    struct _TextIndex *text_index;
+    struct _XPipeTimes load_times;
 };
 
 enum _hy_repo_repodata {
@@ -72,6 +76,7 @@ HyRepo hy_repo_link(HyRepo repo);
 int hy_repo_transition(HyRepo repo, enum _hy_repo_state new_state);
 
 void repo_finalize_init(HyRepo hrepo, Repo *repo);
+void repo_reset_load_state(HyRepo hrepo);
 void repo_internalize_all_trigger(Pool *pool);
 void repo_internalize_trigger(Repo *r);
 void repo_update_state(HyRepo repo, enum _hy_repo_repodata which,
@@ -21,6 +21,7 @@
 #define _GNU_SOURCE
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -54,11 +55,14 @@
 #include "query.h"
 #include "repo_internal.h"
 #include "sack_internal.h"
+#include "textindex.h"
 #include "util.h"
 #include "version.h"
+#include "xpipe.h"
 
 #define DEFAULT_CACHE_ROOT "/var/cache/hawkey"
 #define DEFAULT_CACHE_USER "/var/tmp/hawkey"
+#define QUERY_CACHE_SIZE 32
 
 static int
 current_rpmdb_checksum(Pool *pool, unsigned char csout[CHKSUM_BYTES])
@@ -85,29 +89,123 @@ current_rpmdb_checksum(Pool *pool, unsigned char csout[CHKSUM_BYTES])
 }
 
 static int
-can_use_rpmdb_cache(FILE *fp_solv, unsigned char cs[CHKSUM_BYTES])
+rpmdbid_cmp(const void *ap, const void *bp, void *dp)
 {
-    unsigned char cs_cache[CHKSUM_BYTES];
-
-    if (fp_solv &&
-	!checksum_read(cs_cache, fp_solv) &&
-	!checksum_cmp(cs_cache, cs))
-	return 1;
-
-    return 0;
+    Id a = *(const Id *)ap, b = *(const Id *)bp;
+    return a < b ? -1 : a > b;
 }
 
 static int
-can_use_repomd_cache(FILE *fp_solv, unsigned char cs_repomd[CHKSUM_BYTES])
+rpmdbid_find(Queue *sorted, Id rpmdbid)
 {
-    unsigned char cs_cache[CHKSUM_BYTES];
+    int lo = 0, hi = sorted->count;
+
+    while (lo < hi) {
+	int mid = (lo + hi) / 2;
+	if (sorted->elements[mid] < rpmdbid)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo < sorted->count && sorted->elements[lo] == rpmdbid ? lo : -1;
+}
 
-    if (fp_solv &&
-	!checksum_read(cs_cache, fp_solv) &&
-	!checksum_cmp(cs_cache, cs_repomd))
-	return 1;
+/**
+ * Load a stale @System cache into the empty repo and bring it up to date
+ * with the rpmdb, whose header ids are rpmdbids.
+ *
+ * The packages whose rpmdbid is gone are dropped and add() is called for the
+ * ids the cache does not have, except those in skip. rpmdbids gets sorted.
+ * Returns 0 on success, storing the counts in nadded and nremoved. Returns 1
+ * with the repo emptied again if the cache can not be used or add() fails.
+ */
+int
+rpmdb_cache_update(Repo *repo, FILE *fp_cache, Queue *rpmdbids,
+		   const Queue *skip, rpmdb_add_fn_t add, void *add_data,
+		   int flags, int *nadded, int *nremoved)
+{
+    Pool *pool = repo->pool;
+    Map seen;
+    int ret = 1;
 
-    return 0;
+    *nadded = *nremoved = 0;
+    map_init(&seen, rpmdbids->count);
+    if (repo_add_solv(repo, fp_cache, 0) || repo->rpmdbid == NULL)
+	goto finish;
+    solv_sort(rpmdbids->elements, rpmdbids->count, sizeof(Id), rpmdbid_cmp,
+	      NULL);
+
+    for (int i = 0; i < skip->count; ++i) {
+	int found = rpmdbid_find(rpmdbids, skip->elements[i]);
+	if (found >= 0)
+	    MAPSET(&seen, found);
+    }
+
+    for (Id p = repo->start; p < repo->end; ++p) {
+	if (pool->solvables[p].repo != repo)
+	    continue;
+	int found = rpmdbid_find(rpmdbids, repo->rpmdbid[p - repo->start]);
+	if (found >= 0) {
+	    MAPSET(&seen, found);
+	    continue;
+	}
+	repo_free_solvable_block(repo, p, 1, 0);
+	(*nremoved)++;
+    }
+
+    for (int i = 0; i < rpmdbids->count; ++i) {
+	if (MAPTST(&seen, i))
+	    continue;
+	Id p = add(repo, rpmdbids->elements[i], add_data,
+		   flags | REPO_NO_INTERNALIZE);
+	if (p == 0)
+	    goto finish;
+	repo_set_num(repo, p, RPM_RPMDBID, rpmdbids->elements[i]);
+	(*nadded)++;
+    }
+    repo_internalize(repo);
+    ret = 0;
+
+ finish:
+    if (ret)
+	repo_empty(repo, 1);
+    map_free(&seen);
+    return ret;
+}
+
+static Id
+add_rpmdb_header(Repo *repo, Id rpmdbid, void *state, int flags)
+{
+    void *handle = rpm_byrpmdbid(state, rpmdbid);
+    return handle ? repo_add_rpm_handle(repo, handle, flags) : 0;
+}
+
+/* see HY_LOAD_INCREMENTAL, returns 0 on success */
+static int
+update_rpmdb_cache(HySack sack, Repo *repo, FILE *fp_cache, int flags)
+{
+    Pool *pool = repo->pool;
+    void *state = rpm_state_create(pool, pool_get_rootdir(pool));
+    Queue rpmdbids, gpgkeys;
+    int nadded, nremoved, ret = 1;
+
+    queue_init(&rpmdbids);
+    queue_init(&gpgkeys);
+    // the keys never make it to the repo, see repo_add_rpmdb()
+    if (state &&
+	rpm_installedrpmdbids(state, "Name", NULL, &rpmdbids) >= 0 &&
+	rpm_installedrpmdbids(state, "Name", "gpg-pubkey", &gpgkeys) >= 0)
+	ret = rpmdb_cache_update(repo, fp_cache, &rpmdbids, &gpgkeys,
+				 add_rpmdb_header, state, flags,
+				 &nadded, &nremoved);
+    if (ret == 0)
+	HY_LOG_INFO("updated cached rpmdb: %d added, %d removed",
+		    nadded, nremoved);
+    if (state)
+	rpm_state_free(state);
+    queue_free(&gpgkeys);
+    queue_free(&rpmdbids);
+    return ret;
 }
 
 static Map *
@@ -120,15 +218,17 @@ free_map_fully(Map *m)
     return NULL;
 }
 
-void
-sack_recompute_considered(HySack sack)
+/* bring pool->considered up to date, returns 1 if whatprovides needs to be
+   created again for it */
+static int
+update_considered_map(HySack sack)
 {
     Pool *pool = sack_pool(sack);
     if (sack->considered_uptodate)
-	return;
+	return 0;
     if (!pool->considered) {
 	if (!sack->repo_excludes && !sack->pkg_excludes)
-	    return;
+	    return 0;
 	pool->considered = solv_calloc(1, sizeof(Map));
 	map_init(pool->considered, pool->nsolvables);
     } else
@@ -142,8 +242,47 @@ sack_recompute_considered(HySack sack)
 	map_subtract(pool->considered, sack->pkg_excludes);
     if (sack->pkg_includes)
 	map_and(pool->considered, sack->pkg_includes);
-    pool_createwhatprovides(sack->pool);
     sack->considered_uptodate = 1;
+    return 1;
+}
+
+void
+sack_recompute_considered(HySack sack)
+{
+    if (update_considered_map(sack))
+	pool_createwhatprovides(sack->pool);
+}
+
+/**
+ * Return the packages a new query starts from: all of them if ignore_excludes
+ * is set, the considered ones otherwise.
+ *
+ * The map is recomputed only after the sack generation changes.
+ */
+const Map *
+sack_query_base(HySack sack, int ignore_excludes)
+{
+    Pool *pool = sack_pool(sack);
+    int i = ignore_excludes ? 1 : 0;
+    Map *m = sack->query_base[i];
+    Id p;
+
+    if (!ignore_excludes)
+	sack_recompute_considered(sack);
+    if (m && sack->query_base_generation[i] == sack->generation)
+	return m;
+
+    if (m == NULL)
+	m = sack->query_base[i] = solv_calloc(1, sizeof(Map));
+    else
+	map_free(m);
+    map_init(m, pool->nsolvables);
+    FOR_PKG_SOLVABLES(p)
+	MAPSET(m, p);
+    if (!ignore_excludes && pool->considered)
+	map_and(m, pool->considered);
+    sack->query_base_generation[i] = sack->generation;
+    return m;
 }
 
 static int
@@ -295,10 +434,52 @@ queue_filter_version(HySack sack, Queue *queue, const char *version)
     queue_truncate(queue, j);
 }
 
+/* Metadata of a repo that a worker thread parsed and stored in the solv
+   format, the main data first and then the extensions by their
+   _hy_repo_repodata. NULL where the cache is good or parsing failed. */
+#define PARSED_MAIN 0
+#define PARSED_EXT(which) ((which) + 1)
+#define PARSED_COUNT PARSED_EXT(_HY_REPODATA_UPDATEINFO + 1)
+
+struct _ParsedRepo {
+    HyRepo hrepo;
+    char *solv[PARSED_COUNT];
+    size_t len[PARSED_COUNT];
+};
+
+static FILE *
+parsed_open(struct _ParsedRepo *parsed, int which)
+{
+    if (parsed == NULL || parsed->solv[which] == NULL)
+	return NULL;
+    return fmemopen(parsed->solv[which], parsed->len[which], "r");
+}
+
+static FILE *
+open_metadata(HyRepo hrepo, const char *fn, int flags)
+{
+    if (flags & HY_LOAD_PIPELINED)
+	return xpipe_open(fn, &hrepo->load_times);
+    return solv_xfopen(fn, "r");
+}
+
+static int
+ext_solv_flags(int which_repodata)
+{
+    int flags = 0;
+    /* the updateinfo is not a real extension */
+    if (which_repodata != _HY_REPODATA_UPDATEINFO)
+	flags |= REPO_EXTEND_SOLVABLES;
+    /* do not pollute the main pool with directory component ids */
+    if (which_repodata == _HY_REPODATA_FILENAMES)
+	flags |= REPO_LOCALPOOL;
+    return flags;
+}
+
 static int
 load_ext(HySack sack, HyRepo hrepo, int which_repodata,
 	 const char *suffix, int which_filename,
-	 int (*cb)(Repo *, FILE *))
+	 int (*cb)(Repo *, FILE *), struct _ParsedRepo *parsed)
 {
     int ret = 0;
     Repo *repo = hrepo->libsolv_repo;
@@ -313,19 +494,12 @@ load_ext(HySack sack, HyRepo hrepo, int which_repodata,
     }
 
     char *fn_cache =  hy_sack_give_cache_fn(sack, name, suffix);
-    fp = fopen(fn_cache, "r");
     assert(hrepo->checksum);
-    if (can_use_repomd_cache(fp, hrepo->checksum)) {
-	int flags = 0;
-	/* the updateinfo is not a real extension */
-	if (which_repodata != _HY_REPODATA_UPDATEINFO)
-	    flags |= REPO_EXTEND_SOLVABLES;
-	/* do not pollute the main pool with directory component ids */
-	if (which_repodata == _HY_REPODATA_FILENAMES)
-	    flags |= REPO_LOCALPOOL;
+    fp = cache_open(fn_cache, hrepo->checksum);
+    if (fp) {
 	done = 1;
 	HY_LOG_INFO("%s: using cache file: %s", __func__, fn_cache);
-	ret = repo_add_solv(repo, fp, flags);
+	ret = repo_add_solv(repo, fp, ext_solv_flags(which_repodata));
 	assert(ret == 0);
 	if (ret)
 	    ret = HY_E_LIBSOLV;
@@ -340,16 +514,22 @@ load_ext(HySack sack, HyRepo hrepo, int which_repodata,
     if (done)
 	goto finish;
 
-    fp = solv_xfopen(fn, "r");
-    if (fp == NULL) {
-	HY_LOG_ERROR(format_err_str("Failed to open: %s.", fn));
-	ret = HY_E_IO;
-	goto finish;
-    }
-    HY_LOG_INFO("%s: loading: %s", __func__, fn);
-
     int previous_last = repo->nrepodata - 1;
-    ret = cb(repo, fp);
+    fp = parsed_open(parsed, PARSED_EXT(which_repodata));
+    if (fp) {
+	HY_LOG_INFO("%s: loading parsed: %s", __func__, fn);
+	if (repo_add_solv(repo, fp, ext_solv_flags(which_repodata)))
+	    ret = HY_E_LIBSOLV;
+    } else {
+	fp = open_metadata(hrepo, fn, hrepo->load_flags);
+	if (fp == NULL) {
+	    HY_LOG_ERROR(format_err_str("Failed to open: %s.", fn));
+	    ret = HY_E_IO;
+	    goto finish;
+	}
+	HY_LOG_INFO("%s: loading: %s", __func__, fn);
+	ret = cb(repo, fp);
+    }
     fclose(fp);
     assert(ret == 0);
     if (ret == 0) {
@@ -362,6 +542,8 @@ load_ext(HySack sack, HyRepo hrepo, int which_repodata,
 	HY_LOG_ERROR("load_ext(...%d....) has failed: %d", which_repodata, ret);
 
     sack->provides_ready = 0;
+
+    sack->generation++;
     return ret;
 }
 
@@ -472,15 +654,15 @@ write_ext_updateinfo_filter(Repo *repo, Repokey *key, void *kfdata)
 }
 
 static int
-write_ext_updateinfo(HyRepo hrepo, Repodata *data, FILE *fp)
+write_ext_updateinfo(Repo *repo, int main_end, int main_nsolvables,
+		     Repodata *data, FILE *fp)
 {
-    Repo *repo = hrepo->libsolv_repo;
     int oldstart = repo->start;
-    repo->start = hrepo->main_end;
-    repo->nsolvables -= hrepo->main_nsolvables;
+    repo->start = main_end;
+    repo->nsolvables -= main_nsolvables;
     int res = repo_write_filtered(repo, fp, write_ext_updateinfo_filter, data, 0);
     repo->start = oldstart;
-    repo->nsolvables += hrepo->main_nsolvables;
+    repo->nsolvables += main_nsolvables;
     return res;
 }
 
@@ -510,7 +692,8 @@ write_ext(HySack sack, HyRepo hrepo, int which_repodata, const char *suffix)
     if (which_repodata != _HY_REPODATA_UPDATEINFO)
 	ret |= repodata_write(data, fp);
     else
-	ret |= write_ext_updateinfo(hrepo, data, fp);
+	ret |= write_ext_updateinfo(repo, hrepo->main_end,
+				    hrepo->main_nsolvables, data, fp);
     ret |= checksum_write(hrepo->checksum, fp);
     ret |= fclose(fp);
 
@@ -547,8 +730,86 @@ write_ext(HySack sack, HyRepo hrepo, int which_repodata, const char *suffix)
     return ret;
 }
 
+/* hrepo's main solvables, repos not loaded through hy_sack_load_repo() have
+   no extensions */
+static int
+text_index_nsolvables(HyRepo hrepo)
+{
+    Repo *repo = hrepo->libsolv_repo;
+    int end = hrepo->main_end > repo->start ? hrepo->main_end : repo->end;
+    return end - repo->start;
+}
+
+static struct _TextIndex *
+read_text_index(HyRepo hrepo, const char *fn)
+{
+    struct _TextIndex *idx = NULL;
+    FILE *fp = cache_open(fn, hrepo->checksum);
+
+    if (fp) {
+	idx = textindex_read(fp, text_index_nsolvables(hrepo));
+	fclose(fp);
+    }
+    return idx;
+}
+
+/* build the text index of hrepo and store it beside the .solv file, unless an
+   up to date one is there already */
 static int
-load_yum_repo(HySack sack, HyRepo hrepo)
+write_text_index(HySack sack, HyRepo hrepo)
+{
+    char *fn = hy_sack_give_cache_fn(sack, hrepo->name, HY_EXT_TEXTINDEX);
+    char *tmp_fn_templ = NULL;
+    int tmp_fd = -1;
+    int ret = 0;
+
+    struct _TextIndex *cached = read_text_index(hrepo, fn);
+    if (cached) {
+	textindex_free(cached);
+	goto done;
+    }
+    if (hrepo->text_index == NULL) {
+	HY_LOG_INFO("building text index for %s", hrepo->name);
+	hrepo->text_index = textindex_build(hrepo->libsolv_repo,
+					    text_index_nsolvables(hrepo));
+    }
+
+    tmp_fn_templ = solv_dupjoin(fn, ".XXXXXX", NULL);
+    tmp_fd = mkstemp(tmp_fn_templ);
+    if (tmp_fd < 0) {
+	HY_LOG_ERROR(format_err_str("Can not create temporary file: %s.",
+				    tmp_fn_templ));
+	ret = HY_E_IO;
+	goto done;
+    }
+    FILE *fp = fdopen(tmp_fd, "w+");
+    if (!fp) {
+	HY_LOG_ERROR(format_err_str("Failed opening tmp file: %s.",
+				    strerror(errno)));
+	ret = HY_E_IO;
+	goto done;
+    }
+
+    HY_LOG_INFO("%s: storing %s to: %s", __func__, hrepo->name, tmp_fn_templ);
+    ret |= textindex_write(hrepo->text_index, fp);
+    ret |= checksum_write(hrepo->checksum, fp);
+    ret |= fclose(fp);
+    if (ret) {
+	HY_LOG_ERROR("write_text_index() has failed: %d", ret);
+	goto done;
+    }
+    ret = mv(sack, tmp_fn_templ, fn);
+
+ done:
+    if (ret && tmp_fd >= 0)
+	unlink(tmp_fn_templ);
+    solv_free(tmp_fn_templ);
+    solv_free(fn);
+    return ret;
+}
+
+static int
+load_yum_repo(HySack sack, HyRepo hrepo, struct _ParsedRepo *parsed)
 {
     int retval = 0;
     Pool *pool = sack->pool;
@@ -558,7 +819,8 @@ load_yum_repo(HySack sack, HyRepo hrepo)
     char *fn_cache = hy_sack_give_cache_fn(sack, name, NULL);
 
     FILE *fp_primary = NULL;
-    FILE *fp_cache = fopen(fn_cache, "r");
+    FILE *fp_parsed = NULL;
+    FILE *fp_cache = NULL;
     FILE *fp_repomd = fopen(fn_repomd, "r");
     if (fp_repomd == NULL) {
 	HY_LOG_ERROR(format_err_str("Can not read file %s: %s.",
@@ -569,7 +831,7 @@ load_yum_repo(HySack sack, HyRepo hrepo)
     checksum_fp(hrepo->checksum, fp_repomd);
 
     assert(hrepo->state_main == _HY_NEW);
-    if (can_use_repomd_cache(fp_cache, hrepo->checksum)) {
+    if ((fp_cache = cache_open(fn_cache, hrepo->checksum)) != NULL) {
 	const char *chksum = pool_checksum_str(pool, hrepo->checksum);
 	HY_LOG_INFO("using cached %s (0x%s)", name, chksum);
 	if (repo_add_solv(repo, fp_cache, 0)) {
@@ -578,9 +840,18 @@ load_yum_repo(HySack sack, HyRepo hrepo)
 	    goto finish;
 	}
 	hrepo->state_main = _HY_LOADED_CACHE;
+    } else if ((fp_parsed = parsed_open(parsed, PARSED_MAIN)) != NULL) {
+	HY_LOG_INFO("fetching %s, parsed in advance", name);
+	if (repo_add_solv(repo, fp_parsed, 0)) {
+	    HY_LOG_ERROR("repo_add_solv() has failed.");
+	    retval = HY_E_LIBSOLV;
+	    goto finish;
+	}
+	hrepo->state_main = _HY_LOADED_FETCH;
     } else {
-	fp_primary = solv_xfopen(hy_repo_get_string(hrepo, HY_REPO_PRIMARY_FN),
-				 "r");
+	fp_primary = open_metadata(hrepo,
+				   hy_repo_get_string(hrepo, HY_REPO_PRIMARY_FN),
+				   hrepo->load_flags);
 	assert(fp_primary);
 
 	HY_LOG_INFO("fetching %s", name);
@@ -600,16 +871,236 @@ load_yum_repo(HySack sack, HyRepo hrepo)
 	fclose(fp_repomd);
     if (fp_primary)
 	fclose(fp_primary);
+    if (fp_parsed)
+	fclose(fp_parsed);
     solv_free(fn_cache);
 
     if (retval == 0) {
 	repo_finalize_init(hrepo, repo);
 	sack->provides_ready = 0;
+	sack->generation++;
     } else
 	repo_free(repo, 1);
     return retval;
 }
 
+static void
+evr_rank_free(struct _EvrRank *idx)
+{
+    if (idx == NULL)
+	return;
+    solv_free(idx->rank);
+    solv_free(idx->name_group);
+    solv_free(idx->namearch_group);
+    solv_free(idx->members);
+    solv_free(idx->group_start);
+    solv_free(idx);
+}
+
+static int
+evr_rank_sortcmp(const void *ap, const void *bp, void *dp)
+{
+    Pool *pool = dp;
+    Id a = *(Id *)ap, b = *(Id *)bp;
+    Solvable *sa = pool->solvables + a;
+    Solvable *sb = pool->solvables + b;
+    int r;
+
+    if (sa->name != sb->name)
+	return sa->name < sb->name ? -1 : 1;
+    r = pool_evrcmp(pool, sa->evr, sb->evr, EVRCMP_COMPARE);
+    if (r)
+	return r;
+    return a - b;
+}
+
+static struct _EvrRank *
+evr_rank_build(Pool *pool)
+{
+    struct _EvrRank *idx = solv_calloc(1, sizeof(*idx));
+    Queue members, arches;
+    Id p;
+
+    idx->nsolvables = pool->nsolvables;
+    idx->rank = solv_calloc(pool->nsolvables, sizeof(int));
+    idx->name_group = solv_calloc(pool->nsolvables, sizeof(Id));
+    idx->namearch_group = solv_calloc(pool->nsolvables, sizeof(Id));
+
+    queue_init(&members);
+    FOR_POOL_SOLVABLES(p)
+	queue_push(&members, p);
+    solv_sort(members.elements, members.count, sizeof(Id),
+	      evr_rank_sortcmp, pool);
+
+    queue_init(&arches);	/* arch, namearch group pairs of the current name */
+    idx->group_start = solv_calloc(members.count + 1, sizeof(int));
+    for (int i = 0; i < members.count; ++i) {
+	p = members.elements[i];
+	Solvable *s = pool->solvables + p;
+	Solvable *prev = i ? pool->solvables + members.elements[i - 1] : NULL;
+
+	if (prev == NULL || prev->name != s->name) {
+	    idx->group_start[idx->nname_groups++] = i;
+	    queue_empty(&arches);
+	    idx->rank[p] = 0;
+	} else if (pool_evrcmp(pool, prev->evr, s->evr, EVRCMP_COMPARE))
+	    idx->rank[p] = idx->rank[members.elements[i - 1]] + 1;
+	else
+	    idx->rank[p] = idx->rank[members.elements[i - 1]];
+	idx->name_group[p] = idx->nname_groups - 1;
+
+	int j;
+	for (j = 0; j < arches.count; j += 2)
+	    if (arches.elements[j] == s->arch)
+		break;
+	if (j == arches.count)
+	    queue_push2(&arches, s->arch, idx->nnamearch_groups++);
+	idx->namearch_group[p] = arches.elements[j + 1];
+    }
+    idx->group_start[idx->nname_groups] = members.count;
+    queue_free(&arches);
+
+    idx->members = solv_memdup2(members.elements, members.count, sizeof(Id));
+    queue_free(&members);
+    return idx;
+}
+
+static void
+id_index_free(struct _IdIndex *idx)
+{
+    if (idx == NULL)
+	return;
+    solv_free(idx->keys);
+    solv_free(idx->start);
+    solv_free(idx->solvables);
+    solv_free(idx->by_str);
+    solv_free(idx);
+}
+
+static int
+id_index_sortcmp(const void *ap, const void *bp, void *dp)
+{
+    const Id *a = ap, *b = bp;
+
+    if (a[0] != b[0])
+	return a[0] < b[0] ? -1 : 1;
+    return a[1] - b[1];
+}
+
+struct _IdIndexSort {
+    Pool *pool;
+    const Id *keys;
+};
+
+static int
+id_index_strcmp(const void *ap, const void *bp, void *dp)
+{
+    struct _IdIndexSort *data = dp;
+
+    return strcmp(pool_id2str(data->pool, data->keys[*(int *)ap]),
+		  pool_id2str(data->pool, data->keys[*(int *)bp]));
+}
+
+/* turn sorted (key, solvable) pairs into an index, duplicates are dropped */
+static struct _IdIndex *
+id_index_from_pairs(Queue *pairs)
+{
+    struct _IdIndex *idx = solv_calloc(1, sizeof(*idx));
+
+    solv_sort(pairs->elements, pairs->count / 2, 2 * sizeof(Id),
+	      id_index_sortcmp, NULL);
+
+    int n = pairs->count / 2, nsolvables = 0;
+    idx->keys = solv_calloc(n, sizeof(Id));
+    idx->start = solv_calloc(n + 1, sizeof(int));
+    idx->solvables = solv_calloc(n, sizeof(Id));
+    for (int i = 0; i < n; ++i) {
+	Id key = pairs->elements[2 * i];
+	Id p = pairs->elements[2 * i + 1];
+	if (idx->nkeys == 0 || idx->keys[idx->nkeys - 1] != key) {
+	    idx->keys[idx->nkeys] = key;
+	    idx->start[idx->nkeys++] = nsolvables;
+	} else if (idx->solvables[nsolvables - 1] == p)
+	    continue;
+	idx->solvables[nsolvables++] = p;
+    }
+    idx->start[idx->nkeys] = nsolvables;
+    return idx;
+}
+
+static struct _IdIndex *
+id_index_build(Pool *pool, Id keyname)
+{
+    struct _IdIndex *idx;
+    Queue pairs;
+    Id p;
+
+    assert(keyname == SOLVABLE_NAME || keyname == SOLVABLE_ARCH);
+    queue_init(&pairs);
+    FOR_POOL_SOLVABLES(p) {
+	Solvable *s = pool_id2solvable(pool, p);
+	queue_push2(&pairs, keyname == SOLVABLE_NAME ? s->name : s->arch, p);
+    }
+    idx = id_index_from_pairs(&pairs);
+    queue_free(&pairs);
+
+    if (keyname == SOLVABLE_NAME) {
+	struct _IdIndexSort data = { pool, idx->keys };
+
+	idx->by_str = solv_calloc(idx->nkeys, sizeof(int));
+	for (int i = 0; i < idx->nkeys; ++i)
+	    idx->by_str[i] = i;
+	solv_sort(idx->by_str, idx->nkeys, sizeof(int), id_index_strcmp, &data);
+    }
+    return idx;
+}
+
+static const Id dep_index_keys[DEP_INDEX_NKEYS] = {
+    SOLVABLE_REQUIRES,
+    SOLVABLE_RECOMMENDS,
+    SOLVABLE_SUGGESTS,
+    SOLVABLE_SUPPLEMENTS,
+    SOLVABLE_ENHANCES,
+    SOLVABLE_CONFLICTS,
+    SOLVABLE_OBSOLETES
+};
+
+/* push a (name, p) pair for every name dep could match on */
+static void
+push_dep_names(Pool *pool, Id dep, Id p, Queue *pairs)
+{
+    while (ISRELDEP(dep)) {
+	Reldep *rd = GETRELDEP(pool, dep);
+	// the evr of a plain relation is a version, in the others a dependency
+	if (rd->flags >= 8)
+	    push_dep_names(pool, rd->evr, p, pairs);
+	dep = rd->name;
+    }
+    queue_push2(pairs, dep, p);
+}
+
+static struct _IdIndex *
+dep_index_build(Pool *pool, Id keyname)
+{
+    struct _IdIndex *idx;
+    Queue pairs, deps;
+    Id p;
+
+    queue_init(&pairs);
+    queue_init(&deps);
+    FOR_POOL_SOLVABLES(p) {
+	Solvable *s = pool_id2solvable(pool, p);
+	queue_empty(&deps);
+	solvable_lookup_idarray(s, keyname, &deps);
+	for (int i = 0; i < deps.count; ++i)
+	    push_dep_names(pool, deps.elements[i], p, &pairs);
+    }
+    queue_free(&deps);
+    idx = id_index_from_pairs(&pairs);
+    queue_free(&pairs);
+    return idx;
+}
+
 /**
  * Creates a new package sack, the fundamental hawkey structure.
  *
@@ -698,6 +1189,23 @@ hy_sack_free(HySack sack)
     free_map_fully(sack->pkg_includes);
     free_map_fully(sack->repo_excludes);
     free_map_fully(pool->considered);
+    free_map_fully(sack->query_base[0]);
+    free_map_fully(sack->query_base[1]);
+    solv_free(sack->evr_split);
+    evr_rank_free(sack->evr_rank);
+    id_index_free(sack->name_index);
+    id_index_free(sack->arch_index);
+    for (int i = 0; i < DEP_INDEX_NKEYS; ++i)
+	id_index_free(sack->dep_index[i]);
+    id_index_free(sack->obsoletes_index);
+    id_index_free(sack->source_index);
+    if (sack->query_cache) {
+	for (int i = 0; i < QUERY_CACHE_SIZE; ++i) {
+	    solv_free(sack->query_cache[i].key);
+	    map_free(&sack->query_cache[i].result);
+	}
+	solv_free(sack->query_cache);
+    }
     pool_free(sack->pool);
     solv_free(sack);
 }
@@ -811,6 +1319,7 @@ hy_sack_add_cmdline_package(HySack sack, const char *fn)
     }
     p = repo_add_rpm(repo, fn, REPO_REUSE_REPODATA|REPO_NO_INTERNALIZE);
     sack->provides_ready = 0;    /* triggers internalizing later */
+    sack->generation++;
     return package_create(sack, p);
 }
 
@@ -831,7 +1340,7 @@ hy_sack_add_excludes(HySack sack, HyPackageSet pset)
 {
     Pool *pool = sack_pool(sack);
     Map *excl = sack->pkg_excludes;
-    Map *nexcl = packageset_get_map(pset);
+    const Map *nexcl = packageset_map_view(pset);
 
     if (excl == NULL) {
 	excl = solv_calloc(1, sizeof(Map));
@@ -841,6 +1350,7 @@ hy_sack_add_excludes(HySack sack, HyPackageSet pset)
     assert(excl->size >= nexcl->size);
     map_or(excl, nexcl);
     sack->considered_uptodate = 0;
+    sack->generation++;
 }
 
 void
@@ -848,7 +1358,7 @@ hy_sack_add_includes(HySack sack, HyPackageSet pset)
 {
     Pool *pool = sack_pool(sack);
     Map *incl = sack->pkg_includes;
-    Map *nincl = packageset_get_map(pset);
+    const Map *nincl = packageset_map_view(pset);
 
     if (incl == NULL) {
 	incl = solv_calloc(1, sizeof(Map));
@@ -858,6 +1368,7 @@ hy_sack_add_includes(HySack sack, HyPackageSet pset)
     assert(incl->size >= nincl->size);
     map_or(incl, nincl);
     sack->considered_uptodate = 0;
+    sack->generation++;
 }
 
 void
@@ -866,12 +1377,13 @@ hy_sack_set_excludes(HySack sack, HyPackageSet pset)
     sack->pkg_excludes = free_map_fully(sack->pkg_excludes);
 
     if (pset) {
-        Map *nexcl = packageset_get_map(pset);
+        const Map *nexcl = packageset_map_view(pset);
 
 	sack->pkg_excludes = solv_calloc(1, sizeof(Map));
 	map_init_clone(sack->pkg_excludes, nexcl);
     }
     sack->considered_uptodate = 0;
+    sack->generation++;
 }
 
 void
@@ -880,12 +1392,13 @@ hy_sack_set_includes(HySack sack, HyPackageSet pset)
     sack->pkg_includes = free_map_fully(sack->pkg_includes);
 
     if (pset) {
-        Map *nincl = packageset_get_map(pset);
+        const Map *nincl = packageset_map_view(pset);
 
 	sack->pkg_includes = solv_calloc(1, sizeof(Map));
 	map_init_clone(sack->pkg_includes, nincl);
     }
     sack->considered_uptodate = 0;
+    sack->generation++;
 }
 
 int
@@ -901,9 +1414,11 @@ hy_sack_repo_enabled(HySack sack, const char *reponame, int enabled)
 	excl = solv_calloc(1, sizeof(Map));
 	map_init(excl, pool->nsolvables);
 	sack->repo_excludes = excl;
-    }
+    } else
+	map_grow(excl, pool->nsolvables);
     repo->disabled = !enabled;
     sack->provides_ready = 0;
+    sack->generation++;
 
     Id p;
     Solvable *s;
@@ -922,11 +1437,10 @@ hy_sack_load_system_repo(HySack sack, HyRepo a_hrepo, int flags)
 {
     Pool *pool = sack_pool(sack);
     char *cache_fn = hy_sack_give_cache_fn(sack, HY_SYSTEM_REPO_NAME, NULL);
-    FILE *cache_fp = fopen(cache_fn, "r");
+    FILE *cache_fp = NULL;
     int rc, ret = 0;
     HyRepo hrepo = a_hrepo;
 
-    solv_free(cache_fn);
     if (hrepo)
 	hy_repo_set_string(hrepo, HY_REPO_NAME, HY_SYSTEM_REPO_NAME);
     else
@@ -941,16 +1455,26 @@ hy_sack_load_system_repo(HySack sack, HyRepo a_hrepo, int flags)
     }
 
     Repo *repo = repo_create(pool, HY_SYSTEM_REPO_NAME);
-    if (can_use_rpmdb_cache(cache_fp, hrepo->checksum)) {
+    if ((cache_fp = cache_open(cache_fn, hrepo->checksum)) != NULL) {
 	const char *chksum = pool_checksum_str(pool, hrepo->checksum);
 	HY_LOG_INFO("using cached rpmdb (0x%s)", chksum);
 	rc = repo_add_solv(repo, cache_fp, 0);
 	if (!rc)
 	    hrepo->state_main = _HY_LOADED_CACHE;
     } else {
-	HY_LOG_INFO("fetching rpmdb");
+	const int incremental = flags & HY_LOAD_INCREMENTAL;
 	int flags = REPO_REUSE_REPODATA | RPM_ADD_WITH_HDRID | REPO_USE_ROOTDIR;
-	rc = repo_add_rpmdb_reffp(repo, cache_fp, flags);
+	// a stale cache still saves reading the unchanged headers
+	cache_fp = fopen(cache_fn, "r");
+	if (cache_fp && incremental &&
+	    !update_rpmdb_cache(sack, repo, cache_fp, flags)) {
+	    rc = 0;
+	} else {
+	    HY_LOG_INFO("fetching rpmdb");
+	    if (cache_fp)
+		rewind(cache_fp);
+	    rc = repo_add_rpmdb_reffp(repo, cache_fp, flags);
+	}
 	if (!rc)
 	    hrepo->state_main = _HY_LOADED_FETCH;
     }
@@ -964,6 +1488,7 @@ hy_sack_load_system_repo(HySack sack, HyRepo a_hrepo, int flags)
     repo_finalize_init(hrepo, repo);
     pool_set_installed(pool, repo);
     sack->provides_ready = 0;
+    sack->generation++;
 
     const int build_cache = flags & HY_BUILD_CACHE;
     if (hrepo->state_main == _HY_LOADED_FETCH && build_cache) {
@@ -978,10 +1503,12 @@ hy_sack_load_system_repo(HySack sack, HyRepo a_hrepo, int flags)
     hrepo->main_nrepodata = repo->nrepodata;
     hrepo->main_end = repo->end;
     sack->considered_uptodate = 0;
+    sack->generation++;
 
  finish:
     if (cache_fp)
 	fclose(cache_fp);
+    solv_free(cache_fn);
     if (a_hrepo == NULL)
 	hy_repo_free(hrepo);
     return ret;
@@ -995,14 +1522,14 @@ hy_sack_load_yum_repo(HySack sack, HyRepo repo, int flags)
     return hy_sack_load_repo(sack, repo, flags);
 }
 
-int
-hy_sack_load_repo(HySack sack, HyRepo repo, int flags)
+static int
+load_repo(HySack sack, HyRepo repo, int flags, struct _ParsedRepo *parsed)
 {
     const int build_cache = flags & HY_BUILD_CACHE;
-    int retval = load_yum_repo(sack, repo);
+    repo->load_flags = flags;
+    int retval = load_yum_repo(sack, repo, parsed);
     if (retval)
 	goto finish;
-    repo->load_flags = flags;
     if (repo->state_main == _HY_LOADED_FETCH && build_cache) {
 	retval = write_main(sack, repo, 1);
 	if (retval)
@@ -1011,10 +1538,15 @@ hy_sack_load_repo(HySack sack, HyRepo repo, int flags)
     repo->main_nsolvables = repo->libsolv_repo->nsolvables;
     repo->main_nrepodata = repo->libsolv_repo->nrepodata;
     repo->main_end = repo->libsolv_repo->end;
+    if ((flags & HY_LOAD_TEXT_INDEX) && build_cache) {
+	retval = write_text_index(sack, repo);
+	if (retval)
+	    goto finish;
+    }
     if (flags & HY_LOAD_FILELISTS) {
 	retval = load_ext(sack, repo, _HY_REPODATA_FILENAMES,
 			  HY_EXT_FILENAMES, HY_REPO_FILELISTS_FN,
-			  load_filelists_cb);
+			  load_filelists_cb, parsed);
 	/* allow missing files */
 	if (retval == HY_E_NO_CAPABILITY) {
 	    HY_LOG_INFO("no filelists metadata available for %s", repo->name);
@@ -1032,7 +1564,7 @@ hy_sack_load_repo(HySack sack, HyRepo repo, int flags)
     if (flags & HY_LOAD_PRESTO) {
 	retval = load_ext(sack, repo, _HY_REPODATA_PRESTO,
 			  HY_EXT_PRESTO, HY_REPO_PRESTO_FN,
-			  load_presto_cb);
+			  load_presto_cb, parsed);
 	/* allow missing files */
 	if (retval == HY_E_NO_CAPABILITY) {
 	    HY_LOG_INFO("no presto metadata available for %s", repo->name);
@@ -1048,7 +1580,7 @@ hy_sack_load_repo(HySack sack, HyRepo repo, int flags)
     if (flags & HY_LOAD_UPDATEINFO) {
 	retval = load_ext(sack, repo, _HY_REPODATA_UPDATEINFO,
 			  HY_EXT_UPDATEINFO, HY_REPO_UPDATEINFO_FN,
-			  load_updateinfo_cb);
+			  load_updateinfo_cb, parsed);
 	/* allow missing files */
 	if (retval == HY_E_NO_CAPABILITY) {
 	    HY_LOG_INFO("no updateinfo available for %s", repo->name);
@@ -1059,7 +1591,14 @@ hy_sack_load_repo(HySack sack, HyRepo repo, int flags)
 	if (repo->state_updateinfo == _HY_LOADED_FETCH && build_cache)
 	    retval = write_ext(sack, repo, _HY_REPODATA_UPDATEINFO, HY_EXT_UPDATEINFO);
     }
+    if (flags & HY_LOAD_PIPELINED) {
+	const struct _XPipeTimes *t = &repo->load_times;
+	HY_LOG_INFO("%s: decompressing %.3fs (stalled %.3fs), "
+		    "parsing %.3fs (stalled %.3fs)", repo->name,
+		    t->decompress, t->decompress_stall, t->parse, t->parse_stall);
+    }
     sack->considered_uptodate = 0;
+    sack->generation++;
  finish:
     if (retval) {
 	hy_errno = retval;
@@ -1068,6 +1607,333 @@ hy_sack_load_repo(HySack sack, HyRepo repo, int flags)
     return 0;
 }
 
+int
+hy_sack_load_repo(HySack sack, HyRepo repo, int flags)
+{
+    return load_repo(sack, repo, flags, NULL);
+}
+
+struct _ParseJobs {
+    HySack sack;
+    struct _ParsedRepo *parsed;
+    int n;
+    int flags;
+    int next;
+    pthread_mutex_t lock;
+};
+
+/* the extensions in the order load_repo() adds them */
+static const struct {
+    int flag;
+    int which_repodata;
+    const char *suffix;
+    int which_filename;
+    int (*cb)(Repo *, FILE *);
+} parse_exts[] = {
+    {HY_LOAD_FILELISTS, _HY_REPODATA_FILENAMES, HY_EXT_FILENAMES,
+     HY_REPO_FILELISTS_FN, load_filelists_cb},
+    {HY_LOAD_PRESTO, _HY_REPODATA_PRESTO, HY_EXT_PRESTO,
+     HY_REPO_PRESTO_FN, load_presto_cb},
+    {HY_LOAD_UPDATEINFO, _HY_REPODATA_UPDATEINFO, HY_EXT_UPDATEINFO,
+     HY_REPO_UPDATEINFO_FN, load_updateinfo_cb}
+};
+
+static int
+cache_is_current(HySack sack, const char *name, const char *suffix,
+		 unsigned char cs[CHKSUM_BYTES], FILE **fp_out)
+{
+    char *fn_cache = hy_sack_give_cache_fn(sack, name, suffix);
+    FILE *fp = cache_open(fn_cache, cs);
+
+    solv_free(fn_cache);
+    if (fp && fp_out)
+	*fp_out = fp;
+    else if (fp)
+	fclose(fp);
+    return fp != NULL;
+}
+
+/* close a stream from open_memstream(), keep what was written if ret is 0 */
+static int
+parsed_close(FILE *fp, char **buf, size_t *len, int ret,
+	     struct _ParsedRepo *parsed, int which)
+{
+    // buf and len are only final after fclose()
+    ret |= fclose(fp);
+    if (ret) {
+	free(*buf);
+	return ret;
+    }
+    parsed->solv[which] = *buf;
+    parsed->len[which] = *len;
+    return 0;
+}
+
+/* Parse the metadata of one repo that is not cached into a private pool and
+   keep it in the solv format. Runs on a worker thread so it only logs
+   through the main thread: a piece that fails here is parsed again by
+   load_repo() which reports the problem. */
+static void
+parse_repo(HySack sack, struct _ParsedRepo *parsed, int flags)
+{
+    HyRepo hrepo = parsed->hrepo;
+    const char *name = hy_repo_get_string(hrepo, HY_REPO_NAME);
+    unsigned char cs[CHKSUM_BYTES];
+    FILE *fp_repomd = fopen(hy_repo_get_string(hrepo, HY_REPO_MD_FN), "r");
+    FILE *fp_cache = NULL, *fp_primary = NULL, *fp;
+    int nexts = 0, exts[sizeof(parse_exts) / sizeof(*parse_exts)];
+    char *buf;
+    size_t len;
+
+    if (fp_repomd == NULL)
+	return;
+    checksum_fp(cs, fp_repomd);
+    for (unsigned i = 0; i < sizeof(parse_exts) / sizeof(*parse_exts); ++i)
+	if ((flags & parse_exts[i].flag) &&
+	    hy_repo_get_string(hrepo, parse_exts[i].which_filename) &&
+	    !cache_is_current(sack, name, parse_exts[i].suffix, cs, NULL))
+	    exts[nexts++] = i;
+
+    Pool *pool = pool_create();
+    Repo *repo = repo_create(pool, name);
+    if (cache_is_current(sack, name, NULL, cs, &fp_cache)) {
+	// the extensions still need the packages
+	if (nexts == 0 || repo_add_solv(repo, fp_cache, 0))
+	    goto finish;
+    } else {
+	const char *fn_primary = hy_repo_get_string(hrepo, HY_REPO_PRIMARY_FN);
+	fp_primary = fn_primary ? open_metadata(hrepo, fn_primary, flags) : NULL;
+	if (fp_primary == NULL ||
+	    repo_add_repomdxml(repo, fp_repomd, 0) ||
+	    repo_add_rpmmd(repo, fp_primary, 0, 0))
+	    goto finish;
+	fp = open_memstream(&buf, &len);
+	if (fp == NULL ||
+	    parsed_close(fp, &buf, &len, repo_write(repo, fp), parsed,
+			 PARSED_MAIN))
+	    goto finish;
+    }
+
+    int main_end = repo->end, main_nsolvables = repo->nsolvables;
+    for (int k = 0; k < nexts; ++k) {
+	int i = exts[k];
+	int which = parse_exts[i].which_repodata;
+
+	fp = open_metadata(hrepo,
+			   hy_repo_get_string(hrepo, parse_exts[i].which_filename),
+			   flags);
+	if (fp == NULL)
+	    break;
+	int ret = parse_exts[i].cb(repo, fp);
+	fclose(fp);
+	if (ret)
+	    break;
+
+	Repodata *data = repo_id2repodata(repo, repo->nrepodata - 1);
+	fp = open_memstream(&buf, &len);
+	if (fp == NULL)
+	    break;
+	if (which != _HY_REPODATA_UPDATEINFO)
+	    ret = repodata_write(data, fp);
+	else
+	    ret = write_ext_updateinfo(repo, main_end, main_nsolvables, data, fp);
+	if (parsed_close(fp, &buf, &len, ret, parsed, PARSED_EXT(which)))
+	    break;
+    }
+
+ finish:
+    if (fp_primary)
+	fclose(fp_primary);
+    if (fp_cache)
+	fclose(fp_cache);
+    fclose(fp_repomd);
+    pool_free(pool);
+}
+
+static void *
+parse_worker(void *arg)
+{
+    struct _ParseJobs *jobs = arg;
+
+    for (;;) {
+	pthread_mutex_lock(&jobs->lock);
+	int i = jobs->next++;
+	pthread_mutex_unlock(&jobs->lock);
+	if (i >= jobs->n)
+	    return NULL;
+	parse_repo(jobs->sack, &jobs->parsed[i], jobs->flags);
+    }
+}
+
+/**
+ * Load n repos the way hy_sack_load_repo() does, parsing the metadata that
+ * is not cached on up to nthreads threads at once.
+ *
+ * The repos are added to the sack in the given order whatever the threads
+ * finish first, so cost and priority work as before. nthreads below 1 means
+ * one thread per online CPU.
+ *
+ * @returns	0 on success, HY_E_FAILED with hy_errno set for the first repo
+ *		that did not load. The repos before that one stay in the sack.
+ */
+int
+hy_sack_load_repos(HySack sack, HyRepo *repos, int n, int flags, int nthreads)
+{
+    int ret = 0;
+
+    if (nthreads < 1)
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > n)
+	nthreads = n;
+    if (nthreads <= 1) {
+	for (int i = 0; i < n && ret == 0; ++i)
+	    ret = load_repo(sack, repos[i], flags, NULL);
+	return ret;
+    }
+
+    struct _ParseJobs jobs = {
+	.sack = sack,
+	.parsed = solv_calloc(n, sizeof(struct _ParsedRepo)),
+	.n = n,
+	.flags = flags,
+	.next = 0,
+	.lock = PTHREAD_MUTEX_INITIALIZER
+    };
+    pthread_t *threads = solv_calloc(nthreads - 1, sizeof(pthread_t));
+    int started = 0;
+
+    for (int i = 0; i < n; ++i)
+	jobs.parsed[i].hrepo = repos[i];
+    // the calling thread is one of the workers
+    for (; started < nthreads - 1; ++started)
+	if (pthread_create(&threads[started], NULL, parse_worker, &jobs))
+	    break;
+    parse_worker(&jobs);
+    for (int i = 0; i < started; ++i)
+	pthread_join(threads[i], NULL);
+    solv_free(threads);
+    HY_LOG_INFO("%s: parsed %d repos on %d threads", __func__, n, started + 1);
+
+    for (int i = 0; i < n && ret == 0; ++i)
+	ret = load_repo(sack, repos[i], flags, &jobs.parsed[i]);
+    for (int i = 0; i < n; ++i)
+	for (int j = 0; j < PARSED_COUNT; ++j)
+	    free(jobs.parsed[i].solv[j]);
+    solv_free(jobs.parsed);
+    pthread_mutex_destroy(&jobs.lock);
+    return ret;
+}
+
+static void
+map_clr_repo(Map *m, Repo *repo)
+{
+    Id p;
+    Solvable *s;
+
+    if (m == NULL)
+	return;
+    FOR_REPO_SOLVABLES(repo, p, s)
+	if (p < (m->size << 3))
+	    MAPCLR(m, p);
+}
+
+/* remove a repo loaded by load_repo() from the sack */
+static void
+drop_repo(HySack sack, Repo *repo)
+{
+    HyRepo hrepo = repo->appdata;
+
+    // the freed ids can be handed out again to the next repo loaded
+    map_clr_repo(sack->pkg_excludes, repo);
+    map_clr_repo(sack->pkg_includes, repo);
+    map_clr_repo(sack->repo_excludes, repo);
+    if (hrepo) {
+	repo_reset_load_state(hrepo);
+	hy_repo_free(hrepo);
+    }
+    repo->appdata = NULL;
+    repo_free(repo, 1);
+
+    sack->provides_ready = 0;
+    sack->considered_uptodate = 0;
+    sack->generation++;
+}
+
+/**
+ * Bring the sack up to date with n repos, reloading only the ones whose
+ * repomd.xml changed since they were loaded.
+ *
+ * A repo the sack does not have yet is loaded like hy_sack_load_repo() does.
+ * One it has under the same name but with a different repomd checksum is
+ * removed and loaded again with flags, keeping its enabled state. Repos of the
+ * sack that are not among repos are left alone. Packages of a replaced repo
+ * must not be used after the call. The provides and the considered packages
+ * are recomputed once at the end.
+ *
+ * @returns	0 on success, HY_E_FAILED with hy_errno set for the first repo
+ *		that could not be refreshed. The repos before that one are
+ *		already refreshed. If its repomd.xml can not be read, hy_errno
+ *		is HY_E_IO and the repo is left as it was. If it fails to load
+ *		after that, it is no longer in the sack.
+ */
+int
+hy_sack_refresh(HySack sack, HyRepo *repos, int n, int flags)
+{
+    Pool *pool = sack_pool(sack);
+    int ret = 0, nreloaded = 0;
+
+    for (int i = 0; i < n && ret == 0; ++i) {
+	HyRepo hrepo = repos[i];
+	const char *name = hy_repo_get_string(hrepo, HY_REPO_NAME);
+	const char *fn_repomd = hy_repo_get_string(hrepo, HY_REPO_MD_FN);
+	Repo *repo = repo_by_name(sack, name);
+	unsigned char cs[CHKSUM_BYTES];
+	int disabled = 0;
+
+	if (repo && (repo == pool->installed || repo->appdata == NULL ||
+		     !strcmp(name, HY_CMDLINE_REPO_NAME))) {
+	    format_err_str("Can not refresh %s.", name);
+	    hy_errno = HY_E_OP;
+	    ret = HY_E_FAILED;
+	    break;
+	}
+
+	// nothing is dropped before the new metadata is known to be there
+	FILE *fp = fn_repomd ? fopen(fn_repomd, "r") : NULL;
+	if (fp == NULL || checksum_fp(cs, fp)) {
+	    HY_LOG_ERROR(format_err_str("Can not read repomd of %s.", name));
+	    if (fp)
+		fclose(fp);
+	    hy_errno = HY_E_IO;
+	    ret = HY_E_FAILED;
+	    break;
+	}
+	fclose(fp);
+
+	if (repo) {
+	    HyRepo loaded = repo->appdata;
+	    if (!checksum_cmp(cs, loaded->checksum))
+		continue;
+	    HY_LOG_INFO("%s: replacing %s", __func__, name);
+	    disabled = repo->disabled;
+	    drop_repo(sack, repo);
+	}
+	ret = load_repo(sack, hrepo, flags, NULL);
+	if (ret == 0 && disabled)
+	    hy_sack_repo_enabled(sack, name, 0);
+	nreloaded++;
+    }
+    HY_LOG_INFO("%s: reloaded %d of %d repos", __func__, nreloaded, n);
+
+    // whatprovides depends on the considered map, create it only once
+    const int considered_changed = update_considered_map(sack);
+    if (!sack->provides_ready)
+	sack_make_provides_ready(sack);
+    else if (considered_changed)
+	pool_createwhatprovides(pool);
+    return ret;
+}
+
 // internal to hawkey
 
 // return true if q1 is a superset of q2
@@ -1160,10 +2026,357 @@ sack_make_provides_ready(HySack sack)
 	queue_free(&addedfileprovides);
 	queue_free(&addedfileprovides_inst);
 	pool_createwhatprovides(sack->pool);
+	evr_rank_free(sack->evr_rank);
+	sack->evr_rank = NULL;
+	id_index_free(sack->name_index);
+	sack->name_index = NULL;
+	id_index_free(sack->arch_index);
+	sack->arch_index = NULL;
+	for (int i = 0; i < DEP_INDEX_NKEYS; ++i) {
+	    id_index_free(sack->dep_index[i]);
+	    sack->dep_index[i] = NULL;
+	}
+	id_index_free(sack->obsoletes_index);
+	sack->obsoletes_index = NULL;
+	id_index_free(sack->source_index);
+	sack->source_index = NULL;
 	sack->provides_ready = 1;
     }
 }
 
+/**
+ * Return where the evr string Id splits into epoch, version and release.
+ *
+ * The split is done on the first request and kept in a hash table of the evrs
+ * asked about so far. String Ids never change their meaning so the table is
+ * never invalidated. The returned pointer is valid until the next call.
+ */
+const struct _EvrSplit *
+sack_evr_split(HySack sack, Id evr)
+{
+    Pool *pool = sack->pool;
+    struct _EvrSplit *split;
+
+    assert(evr > 0 && evr < pool->ss.nstrings);
+    if (2 * (unsigned)(sack->nevr_split + 1) > sack->evr_split_mask) {
+	unsigned size = 2 * (sack->evr_split_mask + 1);
+	struct _EvrSplit *old = sack->evr_split;
+
+	if (size < 256)
+	    size = 256;
+	sack->evr_split = solv_calloc(size, sizeof(struct _EvrSplit));
+	sack->evr_split_mask = size - 1;
+	for (unsigned i = 0; old && i < size / 2; ++i) {
+	    if (old[i].evr == ID_NULL)
+		continue;
+	    unsigned h = id_hash(old[i].evr) & sack->evr_split_mask;
+	    while (sack->evr_split[h].evr)
+		h = (h + 1) & sack->evr_split_mask;
+	    sack->evr_split[h] = old[i];
+	}
+	solv_free(old);
+    }
+
+    unsigned h = id_hash(evr) & sack->evr_split_mask;
+    for (split = sack->evr_split + h; split->evr;
+	 split = sack->evr_split + (h = (h + 1) & sack->evr_split_mask))
+	if (split->evr == evr)
+	    return split;
+
+    // same rules as pool_split_evr()
+    const char *str = pool_id2str(pool, evr), *e, *r;
+    for (e = *str ? str + 1 : str; *e != ':' && *e != '-' && *e != '\0'; ++e)
+	;
+    split->evr = evr;
+    split->epoch = *e == ':' ? strtoul(str, NULL, 10) : 0;
+    split->version = *e == ':' ? e + 1 - str : 0;
+    r = str[split->version] ? strchr(str + split->version + 1, '-') : NULL;
+    if (r == NULL)
+	r = str + strlen(str);
+    split->version_len = r - str - split->version;
+    split->release = *r ? r + 1 - str : r - str;
+    sack->nevr_split++;
+    return split;
+}
+
+/**
+ * Return the index ranking every solvable's evr among the same-named ones.
+ *
+ * Built on demand and dropped whenever the provides are rebuilt, i.e. after the
+ * set of loaded repos changes.
+ */
+const struct _EvrRank *
+sack_evr_rank(HySack sack)
+{
+    sack_make_provides_ready(sack);
+    if (sack->evr_rank == NULL)
+	sack->evr_rank = evr_rank_build(sack->pool);
+    return sack->evr_rank;
+}
+
+/**
+ * Return the index of solvables by their name or arch, keyname is
+ * SOLVABLE_NAME or SOLVABLE_ARCH.
+ *
+ * Has the same lifetime as the evr rank index.
+ */
+const struct _IdIndex *
+sack_id_index(HySack sack, Id keyname)
+{
+    struct _IdIndex **idxp = keyname == SOLVABLE_NAME ?
+	&sack->name_index : &sack->arch_index;
+
+    sack_make_provides_ready(sack);
+    if (*idxp == NULL)
+	*idxp = id_index_build(sack->pool, keyname);
+    return *idxp;
+}
+
+/**
+ * Return the index of solvables by the solvables they obsolete.
+ *
+ * The obsoletes are matched the way the solver does, by name unless the pool
+ * has POOL_FLAG_OBSOLETEUSESPROVIDES set. Has the same lifetime as the evr rank
+ * index.
+ */
+const struct _IdIndex *
+sack_obsoletes_index(HySack sack)
+{
+    Pool *pool = sack->pool;
+
+    sack_make_provides_ready(sack);
+    if (sack->obsoletes_index)
+	return sack->obsoletes_index;
+
+    int obsprovides = pool_get_flag(pool, POOL_FLAG_OBSOLETEUSESPROVIDES);
+    Queue pairs;
+    Id p;
+
+    queue_init(&pairs);
+    FOR_POOL_SOLVABLES(p) {
+	Solvable *s = pool_id2solvable(pool, p);
+	if (!s->obsoletes)
+	    continue;
+	for (Id *r_id = s->repo->idarraydata + s->obsoletes; *r_id; ++r_id) {
+	    Id r, rr;
+
+	    FOR_PROVIDES(r, rr, *r_id) {
+		if (r == SYSTEMSOLVABLE)
+		    continue;
+		if (!obsprovides &&
+		    !pool_match_nevr(pool, pool_id2solvable(pool, r), *r_id))
+		    continue; /* only matching pkg names */
+		queue_push2(&pairs, r, p);
+	    }
+	}
+    }
+    sack->obsoletes_index = id_index_from_pairs(&pairs);
+    queue_free(&pairs);
+    return sack->obsoletes_index;
+}
+
+/**
+ * Return the index of solvables by the name of their source package.
+ *
+ * Source names stored as strings are only looked up, building the index does
+ * not grow the string pool. The solvables whose source name is not in the pool
+ * are filed under ID_NULL, as the name may get interned later by someone else.
+ * Has the same lifetime as the evr rank index.
+ */
+const struct _IdIndex *
+sack_source_index(HySack sack)
+{
+    Pool *pool = sack->pool;
+
+    sack_make_provides_ready(sack);
+    if (sack->source_index)
+	return sack->source_index;
+
+    Queue pairs;
+    Id p;
+
+    queue_init(&pairs);
+    FOR_POOL_SOLVABLES(p) {
+	Solvable *s = pool_id2solvable(pool, p);
+	Id name = solvable_lookup_id(s, SOLVABLE_SOURCENAME);
+	if (!name) {
+	    // not stored as an Id, or the same as the binary name
+	    const char *str = solvable_lookup_str(s, SOLVABLE_SOURCENAME);
+	    name = str ? pool_str2id(pool, str, 0) : s->name;
+	}
+	queue_push2(&pairs, name, p);
+    }
+    sack->source_index = id_index_from_pairs(&pairs);
+    queue_free(&pairs);
+    return sack->source_index;
+}
+
+/**
+ * Return the index of solvables by the names they have a keyname dependency
+ * on, keyname is one of SOLVABLE_REQUIRES, _RECOMMENDS, _SUGGESTS,
+ * _SUPPLEMENTS, _ENHANCES, _CONFLICTS or _OBSOLETES.
+ *
+ * Boolean dependencies are filed under every name they mention so the index
+ * only narrows down the candidates, pool_match_dep() still has the final word.
+ * Has the same lifetime as the evr rank index.
+ */
+const struct _IdIndex *
+sack_dep_index(HySack sack, Id keyname)
+{
+    int i;
+
+    for (i = 0; dep_index_keys[i] != keyname; ++i)
+	assert(i + 1 < DEP_INDEX_NKEYS);
+    sack_make_provides_ready(sack);
+    if (sack->dep_index[i] == NULL)
+	sack->dep_index[i] = dep_index_build(sack->pool, keyname);
+    return sack->dep_index[i];
+}
+
+/**
+ * Find the solvables indexed under key.
+ *
+ * Stores the start of the run in 'solvables' and returns its length, 0 if key
+ * is not there.
+ */
+int
+id_index_lookup(const struct _IdIndex *idx, Id key, const Id **solvables)
+{
+    int lo = 0, hi = idx->nkeys;
+
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+	if (idx->keys[mid] < key)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    if (lo == idx->nkeys || idx->keys[lo] != key)
+	return 0;
+    *solvables = idx->solvables + idx->start[lo];
+    return idx->start[lo + 1] - idx->start[lo];
+}
+
+/**
+ * Find the names starting with the first len characters of prefix.
+ *
+ * The result is the range [*lo, *hi) of positions in idx->by_str, idx must be
+ * the name index.
+ */
+void
+id_index_prefix(Pool *pool, const struct _IdIndex *idx,
+		const char *prefix, size_t len, int *lo, int *hi)
+{
+    int l = 0, h = idx->nkeys;
+
+    assert(idx->by_str);
+    while (l < h) {
+	int mid = l + (h - l) / 2;
+	const char *s = pool_id2str(pool, idx->keys[idx->by_str[mid]]);
+	if (strncmp(s, prefix, len) < 0)
+	    l = mid + 1;
+	else
+	    h = mid;
+    }
+    *lo = l;
+    for (h = idx->nkeys; l < h;) {
+	int mid = l + (h - l) / 2;
+	const char *s = pool_id2str(pool, idx->keys[idx->by_str[mid]]);
+	if (strncmp(s, prefix, len) <= 0)
+	    l = mid + 1;
+	else
+	    h = mid;
+    }
+    *hi = l;
+}
+
+/**
+ * Return the trigram index of hrepo's main solvables, NULL if the repo was not
+ * loaded with HY_LOAD_TEXT_INDEX.
+ *
+ * The index is read from the cache when it was stored there for the same repomd
+ * checksum, otherwise it is built in memory. Only hy_sack_load_repo() writes
+ * it to the cache.
+ */
+struct _TextIndex *
+sack_text_index(HySack sack, HyRepo hrepo)
+{
+    Repo *repo = hrepo->libsolv_repo;
+
+    if (!(hrepo->load_flags & HY_LOAD_TEXT_INDEX) || repo == NULL)
+	return NULL;
+    if (hrepo->text_index)
+	return hrepo->text_index;
+
+    char *fn = hy_sack_give_cache_fn(sack, repo->name, HY_EXT_TEXTINDEX);
+    hrepo->text_index = read_text_index(hrepo, fn);
+    if (hrepo->text_index) {
+	HY_LOG_INFO("%s: using cache file: %s", __func__, fn);
+    } else {
+	HY_LOG_INFO("building text index for %s", repo->name);
+	hrepo->text_index = textindex_build(repo, text_index_nsolvables(hrepo));
+    }
+    solv_free(fn);
+    return hrepo->text_index;
+}
+
+/**
+ * Look up the result of the query with signature key.
+ *
+ * Returns 1 and initializes result with a copy of the cached map on a hit.
+ * Results stored before the last change of the sack never hit.
+ */
+int
+sack_query_cache_get(HySack sack, const char *key, size_t keylen, Map *result)
+{
+    struct _QueryCacheEntry *e = sack->query_cache;
+
+    if (e == NULL)
+	return 0;
+    for (int i = 0; i < QUERY_CACHE_SIZE; ++i, ++e) {
+	if (e->key == NULL || e->generation != sack->generation ||
+	    e->keylen != keylen || memcmp(e->key, key, keylen))
+	    continue;
+	e->last_used = ++sack->query_cache_tick;
+	map_init_clone(result, &e->result);
+	return 1;
+    }
+    return 0;
+}
+
+/**
+ * Remember result as the result of the query with signature key.
+ *
+ * Takes the place of a stale entry if there is one, the least recently used
+ * one otherwise.
+ */
+void
+sack_query_cache_put(HySack sack, const char *key, size_t keylen,
+		     const Map *result)
+{
+    struct _QueryCacheEntry *e, *victim = NULL;
+
+    if (sack->query_cache == NULL)
+	sack->query_cache = solv_calloc(QUERY_CACHE_SIZE, sizeof(*e));
+    e = sack->query_cache;
+    for (int i = 0; i < QUERY_CACHE_SIZE; ++i, ++e) {
+	if (e->key == NULL || e->generation != sack->generation) {
+	    victim = e;
+	    break;
+	}
+	if (victim == NULL || e->last_used < victim->last_used)
+	    victim = e;
+    }
+
+    solv_free(victim->key);
+    map_free(&victim->result);
+    victim->key = solv_memdup(key, keylen);
+    victim->keylen = keylen;
+    map_init_clone(&victim->result, result);
+    victim->generation = sack->generation;
+    victim->last_used = ++sack->query_cache_tick;
+}
+
 Id
 sack_running_kernel(HySack sack)
 {
@@ -36,7 +36,10 @@ enum _hy_sack_repo_load_flags {
     HY_BUILD_CACHE	= 1 << 0,
     HY_LOAD_FILELISTS	= 1 << 1,
     HY_LOAD_PRESTO	= 1 << 2,
-    HY_LOAD_UPDATEINFO	= 1 << 3
+    HY_LOAD_UPDATEINFO	= 1 << 3,
+    HY_LOAD_TEXT_INDEX	= 1 << 4,
+    HY_LOAD_PIPELINED	= 1 << 5,
+    HY_LOAD_INCREMENTAL	= 1 << 6
 };
 
 HySack hy_sack_create(const char *cachedir, const char *arch, const char *rootdir,
@@ -61,6 +64,9 @@ int hy_sack_repo_enabled(HySack sack, const char *reponame, int enabled);
 /**
  * Load RPMDB, the system package database.
  *
+ * With HY_LOAD_INCREMENTAL a stale cache is updated by reading only the
+ * headers added since it was written instead of reloading every header.
+ *
  * @returns           0 on success, HY_E_IO on fatal error,
  *		      HY_E_CACHE_WRITE on cache write error.
  */
@@ -70,6 +76,9 @@ int hy_sack_load_system_repo(HySack sack, HyRepo a_hrepo, int flags);
 // than in 0.5.8, use hy_advisorypkg_get_string instead
 int hy_sack_load_yum_repo(HySack sack, HyRepo hrepo, int flags);
 int hy_sack_load_repo(HySack sack, HyRepo hrepo, int flags);
+int hy_sack_load_repos(HySack sack, HyRepo *repos, int n, int flags,
+		       int nthreads);
+int hy_sack_refresh(HySack sack, HyRepo *repos, int n, int flags);
 
 #ifdef __cplusplus
 }
@@ -30,6 +30,47 @@
 #include "sack.h"
 
 typedef Id(*running_kernel_fn_t)(HySack);
+typedef Id(*rpmdb_add_fn_t)(Repo *repo, Id rpmdbid, void *data, int flags);
+
+/* where an evr string splits, as offsets into it so that nothing is interned */
+struct _EvrSplit {
+    Id evr;		/* 0 in a free slot of the sack's table */
+    unsigned long epoch;
+    int version;
+    int version_len;
+    int release;	/* the end of the string if there is no release */
+};
+
+/* ordinal of each solvable's evr among the solvables of the same name */
+struct _EvrRank {
+    int nsolvables;
+    int *rank;
+    Id *name_group;
+    Id *namearch_group;
+    int nname_groups;
+    int nnamearch_groups;
+    Id *members;	/* solvables by name group, ascending rank */
+    int *group_start;	/* nname_groups + 1 offsets into members */
+};
+
+struct _QueryCacheEntry {
+    char *key;			/* query signature, see query_signature() */
+    size_t keylen;
+    Map result;
+    unsigned generation;
+    unsigned last_used;
+};
+
+/* solvables grouped by the Id of one of their attributes */
+struct _IdIndex {
+    int nkeys;
+    Id *keys;		/* ascending */
+    int *start;		/* nkeys + 1 offsets into solvables */
+    Id *solvables;
+    int *by_str;	/* names only: positions in keys ordered by strcmp() */
+};
+
+#define DEP_INDEX_NKEYS 7
 
 struct _HySack {
     Pool *pool;
@@ -46,6 +87,20 @@ struct _HySack {
     Map *repo_excludes;
     int considered_uptodate;
     int cmdline_repo_created;
+    struct _EvrSplit *evr_split;	/* hashed by evr, see sack_evr_split() */
+    unsigned evr_split_mask;
+    int nevr_split;
+    struct _EvrRank *evr_rank;
+    struct _IdIndex *name_index;
+    struct _IdIndex *arch_index;
+    struct _IdIndex *dep_index[DEP_INDEX_NKEYS];	/* see sack_dep_index() */
+    struct _IdIndex *obsoletes_index;
+    struct _IdIndex *source_index;
+    unsigned generation;	/* bumped on every change to what queries see */
+    struct _QueryCacheEntry *query_cache;
+    unsigned query_cache_tick;
+    Map *query_base[2];		/* indexed by HY_IGNORE_EXCLUDES being set */
+    unsigned query_base_generation[2];
 };
 
 void sack_make_provides_ready(HySack sack);
@@ -53,6 +108,24 @@ Id sack_running_kernel(HySack sack);
 void sack_log(HySack sack, int level, const char *format, ...);
 int sack_knows(HySack sack, const char *name, const char *version, int flags);
 void sack_recompute_considered(HySack sack);
+const Map *sack_query_base(HySack sack, int ignore_excludes);
+struct _TextIndex *sack_text_index(HySack sack, HyRepo hrepo);
+int sack_query_cache_get(HySack sack, const char *key, size_t keylen,
+			 Map *result);
+void sack_query_cache_put(HySack sack, const char *key, size_t keylen,
+			  const Map *result);
+const struct _EvrSplit *sack_evr_split(HySack sack, Id evr);
+const struct _EvrRank *sack_evr_rank(HySack sack);
+const struct _IdIndex *sack_id_index(HySack sack, Id keyname);
+const struct _IdIndex *sack_dep_index(HySack sack, Id keyname);
+const struct _IdIndex *sack_obsoletes_index(HySack sack);
+const struct _IdIndex *sack_source_index(HySack sack);
+int rpmdb_cache_update(Repo *repo, FILE *fp_cache, Queue *rpmdbids,
+		       const Queue *skip, rpmdb_add_fn_t add, void *add_data,
+		       int flags, int *nadded, int *nremoved);
+int id_index_lookup(const struct _IdIndex *idx, Id key, const Id **solvables);
+void id_index_prefix(Pool *pool, const struct _IdIndex *idx,
+		     const char *prefix, size_t len, int *lo, int *hi);
 static inline Pool *sack_pool(HySack sack) { return sack->pool; }
 static inline Id sack_last_solvable(HySack sack)
 {
@@ -28,7 +28,7 @@
 #include "goal_internal.h"
 #include "iutil.h"
 #include "package_internal.h"
-#include "packagelist.h"
+#include "packagelist_internal.h"
 #include "query_internal.h"
 #include "sack_internal.h"
 #include "selector_internal.h"
@@ -149,7 +149,7 @@ hy_selector_matches(HySelector sltr)
 
     HyPackageList plist = hy_packagelist_create();
     for (int i = 0; i < solvables.count; i++)
-        hy_packagelist_push(plist, package_create(sack, solvables.elements[i]));
+        packagelist_push_id(plist, sack, solvables.elements[i]);
 
     queue_free(&solvables);
     queue_free(&job);
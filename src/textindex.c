@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+// libsolv
+#include <solv/pool.h>
+#include <solv/util.h>
+
+// hawkey
+#include "textindex.h"
+
+#define TEXTINDEX_MAGIC "HYTI"
+#define TEXTINDEX_VERSION 1
+
+static const Id text_keys[] = {
+    SOLVABLE_SUMMARY,
+    SOLVABLE_DESCRIPTION,
+    SOLVABLE_URL
+};
+
+static inline unsigned char
+lower(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static void
+push_trigrams(const char *str, Queue *tris)
+{
+    const unsigned char *s = (const unsigned char *)str;
+
+    if (!s[0] || !s[1])
+	return;
+    for (; s[2]; ++s)
+	queue_push(tris, lower(s[0]) << 16 | lower(s[1]) << 8 | lower(s[2]));
+}
+
+static int
+id_sortcmp(const void *ap, const void *bp, void *dp)
+{
+    Id a = *(Id *)ap, b = *(Id *)bp;
+    return a < b ? -1 : a > b;
+}
+
+static int
+pair_sortcmp(const void *ap, const void *bp, void *dp)
+{
+    const Id *a = ap, *b = bp;
+
+    if (a[0] != b[0])
+	return a[0] < b[0] ? -1 : 1;
+    return a[1] - b[1];
+}
+
+static void
+sort_unique(Queue *q)
+{
+    int i, j;
+
+    solv_sort(q->elements, q->count, sizeof(Id), id_sortcmp, NULL);
+    for (i = j = 0; i < q->count; ++i)
+	if (j == 0 || q->elements[j - 1] != q->elements[i])
+	    q->elements[j++] = q->elements[i];
+    queue_truncate(q, j);
+}
+
+static int
+find_trigram(const struct _TextIndex *idx, uint32_t tri)
+{
+    int lo = 0, hi = idx->ntrigrams;
+
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+	if (idx->trigrams[mid] < tri)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    if (lo == idx->ntrigrams || idx->trigrams[lo] != tri)
+	return -1;
+    return lo;
+}
+
+struct _TextIndex *
+textindex_build(Repo *repo, int nsolvables)
+{
+    Pool *pool = repo->pool;
+    struct _TextIndex *idx = solv_calloc(1, sizeof(*idx));
+    Queue pairs, tris;
+
+    queue_init(&pairs);
+    queue_init(&tris);
+    for (int off = 0; off < nsolvables; ++off) {
+	Solvable *s = pool_id2solvable(pool, repo->start + off);
+	if (s->repo != repo)
+	    continue;
+	queue_empty(&tris);
+	for (unsigned k = 0; k < sizeof(text_keys) / sizeof(*text_keys); ++k) {
+	    const char *str = solvable_lookup_str(s, text_keys[k]);
+	    if (str)
+		push_trigrams(str, &tris);
+	}
+	sort_unique(&tris);
+	for (int i = 0; i < tris.count; ++i)
+	    queue_push2(&pairs, tris.elements[i], off);
+    }
+    queue_free(&tris);
+    solv_sort(pairs.elements, pairs.count / 2, 2 * sizeof(Id), pair_sortcmp,
+	      NULL);
+
+    int npostings = pairs.count / 2;
+    idx->nsolvables = nsolvables;
+    idx->trigrams = solv_calloc(npostings, sizeof(uint32_t));
+    idx->start = solv_calloc(npostings + 1, sizeof(uint32_t));
+    idx->postings = solv_calloc(npostings, sizeof(uint32_t));
+    for (int i = 0; i < npostings; ++i) {
+	uint32_t tri = pairs.elements[2 * i];
+	if (idx->ntrigrams == 0 || idx->trigrams[idx->ntrigrams - 1] != tri) {
+	    idx->trigrams[idx->ntrigrams] = tri;
+	    idx->start[idx->ntrigrams++] = i;
+	}
+	idx->postings[i] = pairs.elements[2 * i + 1];
+    }
+    idx->start[idx->ntrigrams] = npostings;
+    queue_free(&pairs);
+    return idx;
+}
+
+/* bytes left in fp from the current position, -1 if fp can not seek */
+static long
+remaining_bytes(FILE *fp)
+{
+    long pos = ftell(fp), end;
+
+    if (pos < 0 || fseek(fp, 0, SEEK_END))
+	return -1;
+    end = ftell(fp);
+    if (end < 0 || fseek(fp, pos, SEEK_SET))
+	return -1;
+    return end - pos;
+}
+
+/* the postings lists must be in bounds so lookups can trust them */
+static int
+textindex_valid(const struct _TextIndex *idx, uint32_t npostings)
+{
+    if (idx->start[0] != 0 || idx->start[idx->ntrigrams] != npostings)
+	return 0;
+    for (int i = 0; i < idx->ntrigrams; ++i)
+	if (idx->start[i] > idx->start[i + 1])
+	    return 0;
+    for (uint32_t i = 0; i < npostings; ++i)
+	if (idx->postings[i] >= (uint32_t)idx->nsolvables)
+	    return 0;
+    return 1;
+}
+
+/**
+ * Read an index stored by textindex_write().
+ *
+ * Returns NULL if the data is damaged or was built for a different number of
+ * solvables. Checking the data belongs to the right repo is up to the caller.
+ */
+struct _TextIndex *
+textindex_read(FILE *fp, int nsolvables)
+{
+    char magic[4];
+    uint32_t header[4];
+    struct _TextIndex *idx;
+
+    if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+	memcmp(magic, TEXTINDEX_MAGIC, sizeof(magic)) ||
+	fread(header, sizeof(header), 1, fp) != 1 ||
+	header[0] != TEXTINDEX_VERSION ||
+	header[1] != (uint32_t)nsolvables)
+	return NULL;
+
+    // the counts are only trusted once the file is known to hold that much
+    uint32_t ntrigrams = header[2], npostings = header[3];
+    uint64_t size = ((uint64_t)ntrigrams * 2 + 1 + npostings) * sizeof(uint32_t);
+    long left = remaining_bytes(fp);
+    if (left < 0 || size > (uint64_t)left || ntrigrams > INT32_MAX)
+	return NULL;
+
+    idx = solv_calloc(1, sizeof(*idx));
+    idx->nsolvables = nsolvables;
+    idx->ntrigrams = ntrigrams;
+    idx->trigrams = solv_calloc(ntrigrams, sizeof(uint32_t));
+    idx->start = solv_calloc(ntrigrams + 1, sizeof(uint32_t));
+    idx->postings = solv_calloc(npostings, sizeof(uint32_t));
+    if (fread(idx->trigrams, sizeof(uint32_t), ntrigrams, fp) != ntrigrams ||
+	fread(idx->start, sizeof(uint32_t), ntrigrams + 1, fp) != ntrigrams + 1 ||
+	fread(idx->postings, sizeof(uint32_t), npostings, fp) != npostings ||
+	!textindex_valid(idx, npostings)) {
+	textindex_free(idx);
+	return NULL;
+    }
+    return idx;
+}
+
+int
+textindex_write(const struct _TextIndex *idx, FILE *fp)
+{
+    uint32_t npostings = idx->start[idx->ntrigrams];
+    uint32_t header[4] = {
+	TEXTINDEX_VERSION, idx->nsolvables, idx->ntrigrams, npostings
+    };
+
+    if (fwrite(TEXTINDEX_MAGIC, 4, 1, fp) != 1 ||
+	fwrite(header, sizeof(header), 1, fp) != 1 ||
+	fwrite(idx->trigrams, sizeof(uint32_t), idx->ntrigrams, fp) !=
+	(size_t)idx->ntrigrams ||
+	fwrite(idx->start, sizeof(uint32_t), idx->ntrigrams + 1, fp) !=
+	(size_t)idx->ntrigrams + 1 ||
+	fwrite(idx->postings, sizeof(uint32_t), npostings, fp) != npostings)
+	return 1;
+    return 0;
+}
+
+void
+textindex_free(struct _TextIndex *idx)
+{
+    if (idx == NULL)
+	return;
+    solv_free(idx->trigrams);
+    solv_free(idx->start);
+    solv_free(idx->postings);
+    solv_free(idx);
+}
+
+/**
+ * Store into offsets the solvables that contain all the trigrams of match,
+ * ignoring case.
+ *
+ * Returns 1 if match is too short to use the index, offsets is untouched then.
+ * Candidates still need to be checked against the actual string.
+ */
+int
+textindex_candidates(const struct _TextIndex *idx, const char *match,
+		     Queue *offsets)
+{
+    Queue tris;
+    int shortest = -1;
+
+    queue_init(&tris);
+    push_trigrams(match, &tris);
+    if (tris.count == 0) {
+	queue_free(&tris);
+	return 1;
+    }
+    sort_unique(&tris);
+
+    queue_empty(offsets);
+    // resolve the trigrams to their positions, start with the shortest list
+    for (int i = 0; i < tris.count; ++i) {
+	int pos = find_trigram(idx, tris.elements[i]);
+	if (pos < 0) {
+	    queue_free(&tris);
+	    return 0;
+	}
+	tris.elements[i] = pos;
+	if (shortest < 0 ||
+	    idx->start[pos + 1] - idx->start[pos] <
+	    idx->start[shortest + 1] - idx->start[shortest])
+	    shortest = pos;
+    }
+    for (uint32_t j = idx->start[shortest]; j < idx->start[shortest + 1]; ++j)
+	queue_push(offsets, idx->postings[j]);
+
+    for (int i = 0; i < tris.count && offsets->count; ++i) {
+	int pos = tris.elements[i];
+	if (pos == shortest)
+	    continue;
+	const uint32_t *p = idx->postings + idx->start[pos];
+	const uint32_t *end = idx->postings + idx->start[pos + 1];
+	int k = 0;
+	for (int j = 0; j < offsets->count; ++j) {
+	    uint32_t off = offsets->elements[j];
+	    while (p < end && *p < off)
+		++p;
+	    if (p == end)
+		break;
+	    if (*p == off)
+		offsets->elements[k++] = off;
+	}
+	queue_truncate(offsets, k);
+    }
+    queue_free(&tris);
+    return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef HY_TEXTINDEX_H
+#define HY_TEXTINDEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// libsolv
+#include <solv/queue.h>
+#include <solv/repo.h>
+
+/* Trigram index over the summaries, descriptions and urls of a repo's first
+   nsolvables solvables. Trigrams are ASCII lowercased, the postings are
+   solvable offsets from repo->start. */
+struct _TextIndex {
+    int nsolvables;
+    int ntrigrams;
+    uint32_t *trigrams;		/* ascending */
+    uint32_t *start;		/* ntrigrams + 1 offsets into postings */
+    uint32_t *postings;
+};
+
+struct _TextIndex *textindex_build(Repo *repo, int nsolvables);
+struct _TextIndex *textindex_read(FILE *fp, int nsolvables);
+int textindex_write(const struct _TextIndex *idx, FILE *fp);
+void textindex_free(struct _TextIndex *idx);
+int textindex_candidates(const struct _TextIndex *idx, const char *match,
+			 Queue *offsets);
+
+#endif // HY_TEXTINDEX_H
@@ -39,6 +39,7 @@ typedef struct _HyAdvisoryRef * HyAdvisoryRef;
 typedef struct _HyAdvisoryRefList * HyAdvisoryRefList;
 typedef struct _HyRepo * HyRepo;
 typedef struct _HyGoal * HyGoal;
+typedef struct _HyGoalResults * HyGoalResults;
 typedef struct _HyNevra * HyNevra;
 typedef struct _HyPackage * HyPackage;
 typedef struct _HyPackageDelta * HyPackageDelta;
@@ -63,6 +64,7 @@ typedef int (*hy_solution_callback)(HyGoal goal, void *callback_data);
 #define HY_EXT_FILENAMES "-filenames"
 #define HY_EXT_UPDATEINFO "-updateinfo"
 #define HY_EXT_PRESTO "-presto"
+#define HY_EXT_TEXTINDEX "-textindex"
 
 #define HY_CHKSUM_MD5		1
 #define HY_CHKSUM_SHA1		2
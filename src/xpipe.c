@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// libsolv
+#include <solv/solv_xfopen.h>
+#include <solv/util.h>
+
+// hawkey
+#include "xpipe.h"
+
+#define XPIPE_NBUFS 8
+#define XPIPE_BUFSIZE (128 * 1024)
+
+/* The decompressing thread fills the ring from 'tail', the parser reads from
+   'head'. A buffer shorter than XPIPE_BUFSIZE is the last one. */
+struct _XPipe {
+    FILE *in;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char *bufs[XPIPE_NBUFS];
+    size_t lens[XPIPE_NBUFS];
+    unsigned head, tail;
+    size_t pos;			/* already read from the head buffer */
+    int eof;
+    int error;
+    int closing;
+    double opened;
+    struct _XPipeTimes local;
+    struct _XPipeTimes *times;
+};
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *
+decompress_thread(void *arg)
+{
+    struct _XPipe *xp = arg;
+
+    for (;;) {
+	double start = now();
+	pthread_mutex_lock(&xp->lock);
+	while (xp->tail - xp->head == XPIPE_NBUFS && !xp->closing)
+	    pthread_cond_wait(&xp->cond, &xp->lock);
+	int closing = xp->closing;
+	pthread_mutex_unlock(&xp->lock);
+	xp->local.decompress_stall += now() - start;
+	if (closing)
+	    return NULL;
+
+	// the parser does not touch this buffer until tail moves past it
+	unsigned slot = xp->tail % XPIPE_NBUFS;
+	start = now();
+	size_t len = fread(xp->bufs[slot], 1, XPIPE_BUFSIZE, xp->in);
+	xp->local.decompress += now() - start;
+
+	pthread_mutex_lock(&xp->lock);
+	xp->lens[slot] = len;
+	if (len)
+	    xp->tail++;
+	if (len < XPIPE_BUFSIZE) {
+	    xp->eof = 1;
+	    xp->error = ferror(xp->in);
+	}
+	pthread_cond_signal(&xp->cond);
+	pthread_mutex_unlock(&xp->lock);
+	if (len < XPIPE_BUFSIZE)
+	    return NULL;
+    }
+}
+
+static ssize_t
+xpipe_read(void *cookie, char *out, size_t size)
+{
+    struct _XPipe *xp = cookie;
+    double start = now();
+
+    pthread_mutex_lock(&xp->lock);
+    while (xp->head == xp->tail && !xp->eof)
+	pthread_cond_wait(&xp->cond, &xp->lock);
+    int empty = xp->head == xp->tail, error = xp->error;
+    pthread_mutex_unlock(&xp->lock);
+    xp->local.parse_stall += now() - start;
+    if (empty)
+	return error ? -1 : 0;
+
+    unsigned slot = xp->head % XPIPE_NBUFS;
+    size_t n = xp->lens[slot] - xp->pos;
+    if (n > size)
+	n = size;
+    memcpy(out, xp->bufs[slot] + xp->pos, n);
+    xp->pos += n;
+    if (xp->pos == xp->lens[slot]) {
+	pthread_mutex_lock(&xp->lock);
+	xp->head++;
+	xp->pos = 0;
+	pthread_cond_signal(&xp->cond);
+	pthread_mutex_unlock(&xp->lock);
+    }
+    return n;
+}
+
+static void
+xpipe_free(struct _XPipe *xp)
+{
+    for (int i = 0; i < XPIPE_NBUFS; ++i)
+	solv_free(xp->bufs[i]);
+    pthread_cond_destroy(&xp->cond);
+    pthread_mutex_destroy(&xp->lock);
+    solv_free(xp);
+}
+
+static int
+xpipe_close(void *cookie)
+{
+    struct _XPipe *xp = cookie;
+    struct _XPipeTimes *t = xp->times;
+
+    pthread_mutex_lock(&xp->lock);
+    xp->closing = 1;
+    pthread_cond_signal(&xp->cond);
+    pthread_mutex_unlock(&xp->lock);
+    pthread_join(xp->thread, NULL);
+
+    if (t) {
+	t->decompress += xp->local.decompress;
+	t->decompress_stall += xp->local.decompress_stall;
+	t->parse += now() - xp->opened - xp->local.parse_stall;
+	t->parse_stall += xp->local.parse_stall;
+    }
+    int ret = fclose(xp->in);
+    xpipe_free(xp);
+    return ret;
+}
+
+/**
+ * Open a possibly compressed file like solv_xfopen() does, but decompress it
+ * on a separate thread, a few buffers ahead of the reader.
+ *
+ * Closing the stream adds how long the stages took to times, if not NULL.
+ * Returns NULL if the file can not be opened.
+ */
+FILE *
+xpipe_open(const char *fn, struct _XPipeTimes *times)
+{
+    cookie_io_functions_t io = {
+	.read = xpipe_read,
+	.close = xpipe_close
+    };
+    FILE *in = solv_xfopen(fn, "r");
+
+    if (in == NULL)
+	return NULL;
+
+    struct _XPipe *xp = solv_calloc(1, sizeof(*xp));
+    xp->in = in;
+    xp->times = times;
+    xp->opened = now();
+    for (int i = 0; i < XPIPE_NBUFS; ++i)
+	xp->bufs[i] = solv_malloc(XPIPE_BUFSIZE);
+    pthread_mutex_init(&xp->lock, NULL);
+    pthread_cond_init(&xp->cond, NULL);
+    if (pthread_create(&xp->thread, NULL, decompress_thread, xp)) {
+	// read on this thread then
+	xpipe_free(xp);
+	return in;
+    }
+
+    FILE *fp = fopencookie(xp, "r", io);
+    if (fp == NULL)
+	xpipe_close(xp);
+    return fp;
+}
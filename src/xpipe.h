@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef HY_XPIPE_H
+#define HY_XPIPE_H
+
+#include <stdio.h>
+
+/* Seconds spent in the two stages of reading a compressed file through
+   xpipe_open(): the thread decompressing it and the one parsing what comes
+   out. The stalls are the times either of them waited for the other. */
+struct _XPipeTimes {
+    double decompress;
+    double decompress_stall;
+    double parse;
+    double parse_stall;
+};
+
+FILE *xpipe_open(const char *fn, struct _XPipeTimes *times);
+
+#endif // HY_XPIPE_H
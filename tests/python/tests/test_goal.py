@@ -120,6 +120,21 @@ class GoalTest(base.TestCase):
         obsoleted = goal.obsoleted_by_package(reinstall)
         self.assertItemsEqual(list(map(str, obsoleted)), ("fool-1-3.noarch", ))
 
+    def test_list_results(self):
+        goal = hawkey.Goal(self.sack)
+        self.assertRaises(hawkey.ValueException, goal.list_results)
+        goal.install(base.by_name_repo(self.sack, "fool", "main"))
+        self.assertTrue(goal.run())
+        results = goal.list_results()
+        self.assertEqual(results.erasures, goal.list_erasures())
+        self.assertEqual(results.installs, goal.list_installs())
+        self.assertEqual(results.reinstalls, goal.list_reinstalls())
+        self.assertEqual(results.obsoleted, goal.list_obsoleted())
+        reinstall = results.reinstalls[0]
+        self.assertEqual(list(results.obsoleted_by), [reinstall])
+        self.assertItemsEqual(list(map(str, results.obsoleted_by[reinstall])),
+                              ("fool-1-3.noarch", ))
+
     def test_req(self):
         goal = hawkey.Goal(self.sack)
         self.assertEqual(goal.req_length(), 0)
@@ -62,6 +62,11 @@ class TestQuery(base.TestCase):
         self.assertEqual(len(q), q.count())
         self.assertTrue(q)
 
+        q = hawkey.Query(self.sack).filter(name=["flying", "penny"])
+        self.assertFalse(q.evaluated)
+        self.assertEqual(q.count(), 2)
+        self.assertTrue(q.evaluated)
+
         q = hawkey.Query(self.sack).filter(name="naturalE")
         self.assertFalse(q)
         self.assertIsNotNone(q.result)
@@ -404,6 +409,22 @@ class TestQuerySetOperations(base.TestCase):
         union = set(self.q1.run() + self.q2.run())
         self.assertEqual(set(qu), union)
 
+    def test_symmetric_difference(self):
+        qs = self.q1.symmetric_difference(self.q2)
+        union = set(self.q1.run() + self.q2.run())
+        both = set(self.q1.intersection(self.q2))
+        self.assertEqual(set(qs), union - both)
+
+    def test_operators(self):
+        self.assertEqual(set(self.q1 & self.q2),
+                         set(self.q1.intersection(self.q2)))
+        self.assertEqual(set(self.q1 | self.q2), set(self.q1.union(self.q2)))
+        self.assertEqual(set(self.q1 - self.q2),
+                         set(self.q1.difference(self.q2)))
+        self.assertEqual(set(self.q1 ^ self.q2),
+                         set(self.q1.symmetric_difference(self.q2)))
+        self.assertRaises(TypeError, lambda: self.q1 & [])
+
     def test_zzz_queries_not_modified(self):
         self.assertEqual(len(self.q1), 5)
         self.assertEqual(len(self.q2), 5)
@@ -46,3 +46,10 @@ class Package(unittest.TestCase):
             r.repomd_fn = 3
         r.repomd_fn = 'rain'
         self.assertEqual(r.repomd_fn, 'rain')
+
+    def test_load_times(self):
+        r = hawkey.Repo('fog')
+        times = r.load_times
+        self.assertEqual(sorted(times), ['decompress', 'decompress_stall',
+                                         'parse', 'parse_stall'])
+        self.assertEqual(times['parse'], 0.0)
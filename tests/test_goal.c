@@ -513,6 +513,63 @@ START_TEST(test_goal_upgrade_all)
 }
 END_TEST
 
+static void
+assert_same_list(HyPackageList plist1, HyPackageList plist2)
+{
+    ck_assert_int_eq(hy_packagelist_count(plist1), hy_packagelist_count(plist2));
+    for (int i = 0; i < hy_packagelist_count(plist1); ++i)
+	fail_unless(hy_package_identical(hy_packagelist_get(plist1, i),
+					 hy_packagelist_get(plist2, i)));
+}
+
+START_TEST(test_goal_results)
+{
+    HyGoal goal = hy_goal_create(test_globals.sack);
+    fail_unless(hy_goal_results(goal) == NULL);
+    fail_unless(hy_get_errno() == HY_E_OP);
+    hy_goal_upgrade_all(goal);
+    fail_if(hy_goal_run(goal));
+
+    HyGoalResults res = hy_goal_results(goal);
+    HyPackageList (*lists[])(HyGoal) = {
+	[HY_RESULT_ERASURES] = hy_goal_list_erasures,
+	[HY_RESULT_INSTALLS] = hy_goal_list_installs,
+	[HY_RESULT_OBSOLETED] = hy_goal_list_obsoleted,
+	[HY_RESULT_REINSTALLS] = hy_goal_list_reinstalls,
+	[HY_RESULT_UPGRADES] = hy_goal_list_upgrades,
+	[HY_RESULT_DOWNGRADES] = hy_goal_list_downgrades
+    };
+    for (int i = HY_RESULT_ERASURES; i <= HY_RESULT_DOWNGRADES; ++i) {
+	HyPackageList plist = lists[i](goal);
+	assert_same_list(hy_goal_results_get(res, i), plist);
+	hy_packagelist_free(plist);
+    }
+
+    HyPackageList upgrades = hy_goal_results_get(res, HY_RESULT_UPGRADES);
+    HyPackage pkg;
+    int i;
+    FOR_PACKAGELIST(pkg, upgrades, i) {
+	HyPackageList plist1 = hy_goal_list_obsoleted_by_package(goal, pkg);
+	HyPackageList plist2 = hy_goal_results_obsoleted_by(res, pkg);
+	assert_same_list(plist1, plist2);
+	hy_packagelist_free(plist1);
+	hy_packagelist_free(plist2);
+    }
+    // fool obsoletes penny too
+    FOR_PACKAGELIST(pkg, upgrades, i)
+	if (!strcmp(hy_package_get_name(pkg), "fool"))
+	    break;
+    HyPackageList plist = hy_goal_results_obsoleted_by(res, pkg);
+    ck_assert_int_eq(hy_packagelist_count(plist), 2);
+    ck_assert_str_eq(hy_package_get_name(hy_packagelist_get(plist, 1)),
+		     "penny");
+    hy_packagelist_free(plist);
+
+    hy_goal_results_free(res);
+    hy_goal_free(goal);
+}
+END_TEST
+
 START_TEST(test_goal_downgrade)
 {
     HySack sack = test_globals.sack;
@@ -1293,6 +1350,7 @@ goal_suite(void)
     tcase_add_test(tc, test_goal_selector_upgrade_provides);
     tcase_add_test(tc, test_goal_upgrade);
     tcase_add_test(tc, test_goal_upgrade_all);
+    tcase_add_test(tc, test_goal_results);
     tcase_add_test(tc, test_goal_downgrade);
     tcase_add_test(tc, test_goal_get_reason);
     tcase_add_test(tc, test_goal_get_reason_selector);
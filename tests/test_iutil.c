@@ -20,6 +20,7 @@
 
 #define _GNU_SOURCE
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 // libsolv
@@ -121,6 +122,36 @@ START_TEST(test_checksum_write_read)
 }
 END_TEST
 
+START_TEST(test_cache_open)
+{
+    char *new_file = solv_dupjoin(test_globals.tmpdir,
+				  "/test_cache_open", NULL);
+    build_test_file(new_file);
+
+    unsigned char cs[CHKSUM_BYTES], cs_other[CHKSUM_BYTES];
+    char buf[10];
+    FILE *fp = fopen(new_file, "r+");
+    checksum_fp(cs, fp);
+    fail_if(checksum_write(cs, fp));
+    fclose(fp);
+    memset(cs_other, 0, sizeof(cs_other));
+
+    fail_unless(cache_open(new_file, cs_other) == NULL);
+    fail_unless(cache_open("/non/existing", cs) == NULL);
+    fp = cache_open(new_file, cs);
+    fail_if(fp == NULL);
+    fail_unless(fread(buf, 5, 1, fp) == 1);
+    fail_if(memcmp(buf, "empty", 5));
+    fail_if(fseek(fp, -CHKSUM_BYTES, SEEK_END));
+    fail_unless(fread(buf, 1, sizeof(buf), fp) == sizeof(buf));
+    fail_if(memcmp(buf, cs, sizeof(buf)));
+    fail_unless(ftell(fp) == 5 + sizeof(buf));
+    fclose(fp);
+
+    solv_free(new_file);
+}
+END_TEST
+
 START_TEST(test_mkcachedir)
 {
     const char *workdir = test_globals.tmpdir;
@@ -200,6 +231,7 @@ iutil_suite(void)
     tcase_add_test(tc, test_abspath);
     tcase_add_test(tc, test_checksum);
     tcase_add_test(tc, test_checksum_write_read);
+    tcase_add_test(tc, test_cache_open);
     tcase_add_test(tc, test_mkcachedir);
     tcase_add_test(tc, test_str_endswith);
     tcase_add_test(tc, test_str_startswith);
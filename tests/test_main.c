@@ -85,6 +85,8 @@ main(int argc, const char **argv)
     srunner_add_suite(sr, packagelist_suite());
     srunner_add_suite(sr, packageset_suite());
     srunner_add_suite(sr, query_suite());
+    srunner_add_suite(sr, textindex_suite());
+    srunner_add_suite(sr, xpipe_suite());
     srunner_add_suite(sr, selector_suite());
     srunner_add_suite(sr, subject_suite());
     srunner_add_suite(sr, goal_suite());
@@ -20,7 +20,10 @@
 
 // hawkey
 #include "src/package_internal.h"
-#include "src/packagelist.h"
+#include "src/packagelist_internal.h"
+#include "src/query.h"
+#include "fixtures.h"
+#include "testsys.h"
 #include "test_suites.h"
 
 static HyPackage
@@ -72,6 +75,121 @@ START_TEST(test_has)
 }
 END_TEST
 
+START_TEST(test_ids)
+{
+    HyPackageList plist = hy_packagelist_create();
+    HyPackage pkg;
+
+    packagelist_push_id(plist, NULL, 5);
+    hy_packagelist_push(plist, mock_package(6));
+    packagelist_push_id(plist, NULL, 7);
+    fail_unless(hy_packagelist_count(plist) == 3);
+    fail_unless(packagelist_get_id(plist, 0) == 5);
+    fail_unless(packagelist_get_id(plist, 1) == 6);
+    fail_unless(packagelist_get_id(plist, 2) == 7);
+
+    pkg = mock_package(7);
+    fail_unless(hy_packagelist_has(plist, pkg));
+    hy_package_free(pkg);
+
+    fail_unless(package_id(hy_packagelist_get(plist, 2)) == 7);
+    pkg = hy_packagelist_get_clone(plist, 0);
+    fail_unless(package_id(pkg) == 5);
+    fail_unless(hy_packagelist_get(plist, 3) == NULL);
+    hy_packagelist_free(plist);
+    hy_package_free(pkg);
+}
+END_TEST
+
+START_TEST(test_from_map)
+{
+    Map m;
+
+    map_init(&m, 100);
+    MAPSET(&m, 3);
+    MAPSET(&m, 64);
+    HyPackageList plist = packagelist_from_map(NULL, &m);
+    fail_unless(hy_packagelist_count(plist) == 2);
+    fail_unless(packagelist_get_id(plist, 1) == 64);
+    fail_unless(package_id(hy_packagelist_get(plist, 0)) == 3);
+    hy_packagelist_push(plist, mock_package(80));
+    fail_unless(package_id(hy_packagelist_get(plist, 2)) == 80);
+    hy_packagelist_free(plist);
+    map_free(&m);
+}
+END_TEST
+
+START_TEST(test_has_many)
+{
+    HyPackageList plist = hy_packagelist_create();
+    HyPackage pkg;
+
+    for (int i = 0; i < 40; ++i)
+	packagelist_push_id(plist, NULL, 2 * i);
+    pkg = mock_package(78);
+    fail_unless(hy_packagelist_has(plist, pkg));
+    hy_package_free(pkg);
+    pkg = mock_package(79);
+    fail_if(hy_packagelist_has(plist, pkg));
+    hy_package_free(pkg);
+
+    // the set follows the list as it grows
+    for (int i = 40; i < 100; ++i)
+	hy_packagelist_push(plist, mock_package(2 * i));
+    pkg = mock_package(198);
+    fail_unless(hy_packagelist_has(plist, pkg));
+    hy_package_free(pkg);
+    pkg = mock_package(199);
+    fail_if(hy_packagelist_has(plist, pkg));
+    hy_package_free(pkg);
+    hy_packagelist_free(plist);
+}
+END_TEST
+
+START_TEST(test_dedup)
+{
+    HyPackageList plist = hy_packagelist_create();
+
+    hy_packagelist_push(plist, mock_package(7));
+    hy_packagelist_push(plist, mock_package(3));
+    packagelist_push_id(plist, NULL, 7);
+    hy_packagelist_push(plist, mock_package(5));
+    hy_packagelist_push(plist, mock_package(3));
+    hy_packagelist_dedup(plist);
+    fail_unless(hy_packagelist_count(plist) == 3);
+    fail_unless(packagelist_get_id(plist, 0) == 7);
+    fail_unless(packagelist_get_id(plist, 1) == 3);
+    fail_unless(package_id(hy_packagelist_get(plist, 2)) == 5);
+    hy_packagelist_free(plist);
+}
+END_TEST
+
+START_TEST(test_sort)
+{
+    HyQuery q = hy_query_create(test_globals.sack);
+    HyPackageList all = hy_query_run(q);
+    HyPackageList plist = hy_packagelist_create();
+    int count = hy_packagelist_count(all);
+
+    for (int i = count - 1; i >= 0; --i)
+	hy_packagelist_push(plist, hy_packagelist_get_clone(all, i));
+    hy_packagelist_sort(plist);
+    fail_unless(hy_packagelist_count(plist) == count);
+    for (int i = 1; i < count; ++i)
+	fail_unless(hy_package_cmp(hy_packagelist_get(plist, i - 1),
+				   hy_packagelist_get(plist, i)) <= 0);
+
+    // lists filled by Id sort the same
+    hy_packagelist_sort(all);
+    for (int i = 0; i < count; ++i)
+	fail_unless(packagelist_get_id(all, i) == packagelist_get_id(plist, i));
+
+    hy_packagelist_free(plist);
+    hy_packagelist_free(all);
+    hy_query_free(q);
+}
+END_TEST
+
 Suite *
 packagelist_suite(void)
 {
@@ -81,6 +199,15 @@ packagelist_suite(void)
     tcase_add_unchecked_fixture(tc, create_fixture, free_fixture);
     tcase_add_test(tc, test_iter_macro);
     tcase_add_test(tc, test_has);
+    tcase_add_test(tc, test_ids);
+    tcase_add_test(tc, test_from_map);
+    tcase_add_test(tc, test_has_many);
+    tcase_add_test(tc, test_dedup);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Sort");
+    tcase_add_unchecked_fixture(tc, fixture_all, teardown);
+    tcase_add_test(tc, test_sort);
     suite_add_tcase(s, tc);
 
     return s;
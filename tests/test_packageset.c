@@ -164,6 +164,265 @@ START_TEST(test_get_pkgid)
 }
 END_TEST
 
+START_TEST(test_next)
+{
+    HySack sack = test_globals.sack;
+    HyPackage pkg;
+    Id ids[3];
+    int n = 0;
+
+    for (pkg = hy_packageset_next(pset, NULL); pkg;
+	 pkg = hy_packageset_next(pset, pkg)) {
+	fail_unless(n < 3);
+	ids[n++] = package_id(pkg);
+    }
+    fail_unless(n == 3);
+    fail_unless(ids[0] == 0);
+    fail_unless(ids[1] == 9);
+    fail_unless(ids[2] == sack_last_solvable(sack));
+}
+END_TEST
+
+START_TEST(test_get_pkgid_rank)
+{
+    HySack sack = test_globals.sack;
+    Map m;
+
+    // spans several rank blocks
+    map_init(&m, 3000);
+    for (int i = 0; i < 3000; i += 3)
+	MAPSET(&m, i);
+    HyPackageSet big = packageset_from_bitmap(sack, &m);
+    for (int i = 999; i >= 0; --i)
+	fail_unless(packageset_get_pkgid(big, i, -1) == 3 * i);
+    fail_unless(hy_packageset_get_clone(big, 1000) == NULL);
+
+    // adding invalidates the index
+    hy_packageset_add(big, package_create(sack, 1));
+    fail_unless(packageset_get_pkgid(big, 1, -1) == 1);
+    fail_unless(packageset_get_pkgid(big, 999, -1) == 2994);
+    hy_packageset_free(big);
+    map_free(&m);
+}
+END_TEST
+
+START_TEST(test_set_operations)
+{
+    HySack sack = test_globals.sack;
+    Id max = sack_last_solvable(sack);
+    const Id ids[] = {7, 9, 15};
+    HyPackageSet other = hy_packageset_create(sack);
+    HyPackageSet res;
+
+    packageset_add_ids(other, ids, 3);
+    fail_unless(hy_packageset_count(other) == 3);
+
+    res = hy_packageset_union_clone(pset, other);
+    fail_unless(hy_packageset_count(res) == 5);
+    fail_unless(hy_packageset_is_subset(pset, res));
+    fail_unless(hy_packageset_is_subset(other, res));
+    hy_packageset_free(res);
+
+    res = hy_packageset_intersection_clone(pset, other);
+    fail_unless(hy_packageset_count(res) == 1);
+    fail_unless(packageset_get_pkgid(res, 0, -1) == 9);
+    fail_unless(hy_packageset_is_subset(res, pset));
+    hy_packageset_free(res);
+
+    res = hy_packageset_difference_clone(pset, other);
+    fail_unless(hy_packageset_count(res) == 2);
+    fail_unless(packageset_get_pkgid(res, 1, -1) == max);
+    hy_packageset_free(res);
+
+    res = hy_packageset_symmetric_difference_clone(pset, other);
+    fail_unless(hy_packageset_count(res) == 4);
+    fail_if(hy_packageset_is_subset(res, pset));
+    hy_packageset_free(res);
+
+    // in place, the operands stay as they were
+    res = hy_packageset_clone(pset);
+    hy_packageset_union(res, other);
+    packageset_remove_ids(res, ids, 3);
+    hy_packageset_union(res, pset);
+    fail_unless(hy_packageset_count(res) == 3);
+    hy_packageset_difference(res, other);
+    hy_packageset_symmetric_difference(res, pset);
+    fail_unless(hy_packageset_count(res) == 1);
+    hy_packageset_intersection(res, other);
+    fail_unless(packageset_get_pkgid(res, 0, -1) == 9);
+    fail_unless(hy_packageset_count(pset) == 3);
+    fail_unless(hy_packageset_count(other) == 3);
+    hy_packageset_free(res);
+    hy_packageset_free(other);
+}
+END_TEST
+
+START_TEST(test_map_combine)
+{
+    Map small, big;
+
+    map_init(&small, 10);
+    map_init(&big, 300);
+    MAPSET(&small, 3);
+    MAPSET(&big, 3);
+    MAPSET(&big, 200);
+
+    fail_unless(map_is_subset(&small, &big));
+    fail_if(map_is_subset(&big, &small));
+    map_combine(&small, &big, MAP_OP_XOR);
+    fail_unless(map_count(&small) == 1);
+    fail_unless(MAPTST(&small, 200));
+    map_combine(&big, &small, MAP_OP_AND);
+    fail_unless(map_count(&big) == 1);
+
+    map_free(&small);
+    map_init(&small, 10);
+    MAPSET(&small, 3);
+    map_combine(&big, &small, MAP_OP_AND);
+    fail_unless(map_count(&big) == 0);
+    map_free(&small);
+    map_free(&big);
+}
+END_TEST
+
+START_TEST(test_sparse_dense)
+{
+    HySack sack = test_globals.sack;
+    Id max = sack_last_solvable(sack);
+    HyPackageSet big = hy_packageset_create(sack);
+    Id ids[40];
+
+    // well over the point where a set turns into a bitmap, the Ids need not
+    // be in the pool
+    for (int i = 0; i < 40; ++i)
+	ids[i] = max + 1 + i;
+    packageset_add_ids(big, ids, 40);
+    packageset_add_ids(big, ids, 40);
+    fail_unless(hy_packageset_count(big) == 40);
+    fail_unless(packageset_get_pkgid(big, 39, -1) == max + 40);
+    fail_unless(packageset_get_pkgid(big, 0, max + 1) == max + 2);
+
+    HyPackageSet res = hy_packageset_union_clone(pset, big);
+    fail_unless(hy_packageset_count(res) == 43);
+    fail_unless(hy_packageset_is_subset(pset, res));
+    fail_unless(hy_packageset_is_subset(big, res));
+    fail_if(hy_packageset_is_subset(res, big));
+    hy_packageset_symmetric_difference(res, pset);
+    fail_unless(hy_packageset_count(res) == 40);
+    hy_packageset_free(res);
+
+    // a dense set intersected with a sparse one
+    ids[0] = 9;
+    ids[1] = max + 6;
+    packageset_add_ids(pset, ids, 2);
+    res = hy_packageset_intersection_clone(big, pset);
+    fail_unless(hy_packageset_count(res) == 1);
+    fail_unless(packageset_get_pkgid(res, 0, -1) == max + 6);
+    hy_packageset_free(res);
+    res = hy_packageset_difference_clone(pset, big);
+    fail_unless(hy_packageset_count(res) == 3);
+    hy_packageset_free(res);
+
+    // materializing keeps the members
+    Map *m = packageset_get_map(pset);
+    fail_unless(map_count(m) == 4);
+    fail_unless(MAPTST(m, 0) && MAPTST(m, 9) && MAPTST(m, max) &&
+		MAPTST(m, max + 6));
+    fail_unless(hy_packageset_count(pset) == 4);
+
+    packageset_remove_ids(big, ids + 1, 1);
+    fail_unless(hy_packageset_count(big) == 39);
+    hy_packageset_free(big);
+}
+END_TEST
+
+START_TEST(test_map_view)
+{
+    HySack sack = test_globals.sack;
+    Id max = sack_last_solvable(sack);
+    HyPackageSet sparse = hy_packageset_create(sack);
+    Id ids[40] = { 1, 5, 7 };
+
+    // reading the map of a sparse set follows its changes
+    packageset_add_ids(sparse, ids, 2);
+    const Map *view = packageset_map_view(sparse);
+    fail_unless(map_count(view) == 2);
+    fail_unless(MAPTST(view, 1) && MAPTST(view, 5));
+    packageset_add_ids(sparse, ids + 2, 1);
+    view = packageset_map_view(sparse);
+    fail_unless(map_count(view) == 3 && MAPTST(view, 7));
+
+    HyPackageSet clone = hy_packageset_clone(sparse);
+    fail_unless(map_count(packageset_map_view(clone)) == 3);
+    hy_packageset_free(clone);
+    fail_unless(packageset_get_pkgid(sparse, 2, -1) == 7);
+    hy_packageset_free(sparse);
+
+    // writing through the map of a dense set does not leave the rank stale
+    HyPackageSet dense = hy_packageset_create(sack);
+    for (int i = 0; i < 40; ++i)
+	ids[i] = max + 1 + i;
+    packageset_add_ids(dense, ids, 40);
+    fail_unless(packageset_get_pkgid(dense, 39, -1) == max + 40);
+    Map *m = packageset_get_map(dense);
+    MAPSET(m, 0);
+    fail_unless(hy_packageset_count(dense) == 41);
+    fail_unless(packageset_get_pkgid(dense, 0, -1) == 0);
+    fail_unless(packageset_get_pkgid(dense, 40, -1) == max + 40);
+    hy_packageset_free(dense);
+}
+END_TEST
+
+START_TEST(test_map_next)
+{
+    Map m;
+    Id id;
+
+    map_init(&m, 300);
+    fail_unless(map_next(&m, -1) == -1);
+    MAPSET(&m, 0);
+    MAPSET(&m, 5);
+    MAPSET(&m, 70);
+    MAPSET(&m, 128);
+    MAPSET(&m, 299);
+
+    id = map_next(&m, -1);
+    fail_unless(id == 0);
+    id = map_next(&m, id);
+    fail_unless(id == 5);
+    id = map_next(&m, id);
+    fail_unless(id == 70);
+    id = map_next(&m, id);
+    fail_unless(id == 128);
+    id = map_next(&m, id);
+    fail_unless(id == 299);
+    fail_unless(map_next(&m, id) == -1);
+
+    int count = 0;
+    FOR_MAP_SET(&m, id)
+	count++;
+    fail_unless(count == 4); // starts past 0
+    map_free(&m);
+}
+END_TEST
+
+START_TEST(test_map_set_range)
+{
+    Map m;
+
+    map_init(&m, 300);
+    map_set_range(&m, 3, 5);
+    map_set_range(&m, 13, 13);
+    map_set_range(&m, 21, 290);
+    map_set_range(&m, 296, 300);
+    for (int i = 0; i < 300; ++i)
+	fail_unless(!MAPTST(&m, i) ==
+		    !((i >= 3 && i < 5) || (i >= 21 && i < 290) || i >= 296));
+    fail_unless(map_count(&m) == 2 + 269 + 4);
+    map_free(&m);
+}
+END_TEST
+
 Suite *
 packageset_suite(void)
 {
@@ -175,6 +434,14 @@ packageset_suite(void)
     tcase_add_test(tc, test_has);
     tcase_add_test(tc, test_get_clone);
     tcase_add_test(tc, test_get_pkgid);
+    tcase_add_test(tc, test_next);
+    tcase_add_test(tc, test_get_pkgid_rank);
+    tcase_add_test(tc, test_set_operations);
+    tcase_add_test(tc, test_sparse_dense);
+    tcase_add_test(tc, test_map_view);
+    tcase_add_test(tc, test_map_next);
+    tcase_add_test(tc, test_map_combine);
+    tcase_add_test(tc, test_map_set_range);
     suite_add_tcase(s, tc);
 
     return s;
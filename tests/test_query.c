@@ -29,7 +29,9 @@
 #include "src/package.h"
 #include "src/packageset.h"
 #include "src/reldep.h"
+#include "src/repo_internal.h"
 #include "src/sack_internal.h"
+#include "src/util.h"
 #include "fixtures.h"
 #include "test_suites.h"
 #include "testsys.h"
@@ -69,6 +71,19 @@ START_TEST(test_query_run_set_sanity)
 }
 END_TEST
 
+START_TEST(test_query_count)
+{
+    HyQuery q = hy_query_create(test_globals.sack);
+
+    fail_unless(hy_query_count(q) == TEST_EXPECT_SYSTEM_NSOLVABLES);
+    hy_query_filter(q, HY_PKG_NAME, HY_EQ, "penny");
+    fail_unless(hy_query_count(q) == 1);
+    hy_query_filter(q, HY_PKG_ARCH, HY_EQ, "i686");
+    fail_unless(hy_query_count(q) == 0);
+    hy_query_free(q);
+}
+END_TEST
+
 START_TEST(test_query_clear)
 {
     HyQuery q;
@@ -95,6 +110,57 @@ START_TEST(test_query_clone)
 }
 END_TEST
 
+START_TEST(test_query_name_arch_in)
+{
+    const char *namelist[] = {"jay", "pilchard", "no-such-name", NULL};
+    const char *archlist[] = {"i686", "x86_64", NULL};
+    HyQuery q;
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter_in(q, HY_PKG_NAME, HY_EQ, namelist);
+    fail_unless(size_and_free(q) == 4);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter_in(q, HY_PKG_NAME, HY_EQ, namelist);
+    hy_query_filter(q, HY_PKG_ARCH, HY_EQ, "i686");
+    fail_unless(size_and_free(q) == 1);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter_in(q, HY_PKG_ARCH, HY_NEQ, archlist);
+    fail_unless(size_and_free(q) == 5);
+}
+END_TEST
+
+START_TEST(test_query_glob_prefix)
+{
+    HyQuery q;
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB, "penny*");
+    fail_unless(size_and_free(q) == 2);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB|HY_ICASE, "PEN?Y");
+    fail_unless(size_and_free(q) == 1);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB, "*-lib");
+    fail_unless(size_and_free(q) == 1);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NEVRA, HY_GLOB, "penny-4*");
+    fail_unless(size_and_free(q) == 1);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NEVRA, HY_GLOB, "pilchard-1.2.3-1.*");
+    fail_unless(size_and_free(q) == 2);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NEVRA, HY_EQ, "penny-lib-4-1.x86_64");
+    fail_unless(size_and_free(q) == 1);
+}
+END_TEST
+
 START_TEST(test_query_empty)
 {
     HyQuery q = hy_query_create(test_globals.sack);
@@ -574,6 +640,94 @@ START_TEST(test_filter_latest)
 }
 END_TEST
 
+/* fail unless filtering both sacks by keyname gives the same packages */
+static int
+text_query_same(HySack sack1, HySack sack2, int keyname, int cmp_type,
+		const char *match)
+{
+    HyQuery q1 = hy_query_create(sack1);
+    HyQuery q2 = hy_query_create(sack2);
+    hy_query_filter(q1, keyname, cmp_type, match);
+    hy_query_filter(q2, keyname, cmp_type, match);
+    HyPackageList plist1 = hy_query_run(q1);
+    HyPackageList plist2 = hy_query_run(q2);
+    int count = hy_packagelist_count(plist1);
+
+    fail_unless(count == hy_packagelist_count(plist2));
+    for (int i = 0; i < count; ++i) {
+	char *nevra1 = hy_package_get_nevra(hy_packagelist_get(plist1, i));
+	char *nevra2 = hy_package_get_nevra(hy_packagelist_get(plist2, i));
+	ck_assert_str_eq(nevra1, nevra2);
+	hy_free(nevra1);
+	hy_free(nevra2);
+    }
+    hy_packagelist_free(plist1);
+    hy_packagelist_free(plist2);
+    hy_query_free(q1);
+    hy_query_free(q2);
+    return count;
+}
+
+START_TEST(test_query_text_index)
+{
+    // a sack of its own, the index stays attached to the repos it was used on
+    HySack sack = hy_sack_create(test_globals.tmpdir, TEST_FIXED_ARCH, NULL,
+				 NULL, HY_MAKE_CACHE_DIR);
+    HySack plain = test_globals.sack;
+    Pool *pool = sack_pool(sack);
+    const char *names[] = {HY_SYSTEM_REPO_NAME, "main", "updates"};
+    Repo *repo;
+    int i;
+
+    for (i = 0; i < 3; ++i) {
+	const char *path = pool_tmpjoin(pool, test_globals.repo_dir, names[i],
+					".repo");
+	fail_if(load_repo(pool, names[i], path, i == 0));
+    }
+    FOR_REPOS(i, repo)
+	((HyRepo)repo->appdata)->load_flags |= HY_LOAD_TEXT_INDEX;
+
+    fail_unless(text_query_same(sack, plain, HY_PKG_SUMMARY, HY_SUBSTR,
+				"ears") == 2);
+    fail_unless(text_query_same(sack, plain, HY_PKG_SUMMARY,
+				HY_SUBSTR|HY_ICASE, "In My E") == 4);
+    fail_unless(text_query_same(sack, plain, HY_PKG_SUMMARY, HY_SUBSTR,
+				"In My E") == 0);
+    fail_unless(text_query_same(sack, plain, HY_PKG_SUMMARY, HY_SUBSTR,
+				"s") == 4);
+    text_query_same(sack, plain, HY_PKG_DESCRIPTION, HY_SUBSTR|HY_ICASE,
+		    "the");
+    FOR_REPOS(i, repo)
+	fail_if(((HyRepo)repo->appdata)->text_index == NULL);
+
+    hy_sack_free(sack);
+}
+END_TEST
+
+START_TEST(test_query_requires_all)
+{
+    HySack sack = test_globals.sack;
+    HyQuery q = hy_query_create(sack);
+
+    hy_query_filter_requires(q, HY_EQ, "P-lib", NULL);
+    fail_unless(size_and_free(q) == 5);
+
+    q = hy_query_create(sack);
+    hy_query_filter_requires(q, HY_LT, "P-lib", "3");
+    fail_unless(size_and_free(q) == 3);
+
+    q = hy_query_create(sack);
+    hy_query_filter_requires(q, HY_EQ, "fool", NULL);
+    hy_query_filter_requires(q, HY_EQ, "semolina", "2");
+    fail_unless(size_and_free(q) == 2);
+
+    q = hy_query_create(sack);
+    hy_query_filter_requires(q, HY_NEQ, "P-lib", NULL);
+    hy_query_filter(q, HY_PKG_NAME, HY_EQ, "flying");
+    fail_unless(size_and_free(q) == 0);
+}
+END_TEST
+
 START_TEST(test_filter_latest2)
 {
     HyQuery q = hy_query_create(test_globals.sack);
@@ -606,6 +760,35 @@ START_TEST(test_filter_latest_archs)
 }
 END_TEST
 
+START_TEST(test_filter_latest_all)
+{
+    HyQuery q = hy_query_create(test_globals.sack);
+    hy_query_filter_latest(q, 1);
+    HyPackageList plist = hy_query_run(q);
+    HyPackage pkg, pkg2;
+    int i, j;
+
+    fail_unless(hy_packagelist_count(plist) > 1);
+    FOR_PACKAGELIST(pkg, plist, i)
+	FOR_PACKAGELIST(pkg2, plist, j)
+	    fail_unless(i == j || strcmp(hy_package_get_name(pkg),
+					 hy_package_get_name(pkg2)));
+
+    hy_query_free(q);
+    hy_packagelist_free(plist);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_EQ, "flying");
+    hy_query_filter_latest(q, 1);
+    plist = hy_query_run(q);
+    fail_unless(hy_packagelist_count(plist) == 1);
+    pkg = hy_packagelist_get(plist, 0);
+    fail_if(strcmp(hy_package_get_evr(pkg), "3.2-0"));
+    hy_query_free(q);
+    hy_packagelist_free(plist);
+}
+END_TEST
+
 START_TEST(test_upgrade_already_installed)
 {
     /* if pkg is installed in two versions and the later is available in repos,
@@ -802,6 +985,34 @@ START_TEST(test_filter_sourcerpm)
 }
 END_TEST
 
+START_TEST(test_filter_sourcerpm_uninterned)
+{
+    HySack sack = hy_sack_create(test_globals.tmpdir, TEST_FIXED_ARCH, NULL,
+				 NULL, HY_MAKE_CACHE_DIR);
+    Pool *pool = sack_pool(sack);
+    const char *path = pool_tmpjoin(pool, test_globals.repo_dir,
+				    HY_SYSTEM_REPO_NAME, ".repo");
+    fail_if(load_repo(pool, HY_SYSTEM_REPO_NAME, path, 1));
+
+    // a source name stored as a string that is nowhere else in the pool
+    const char *source = "uninterned-source";
+    Repo *repo = pool->installed;
+    solvable_set_str(pool_id2solvable(pool, repo->start), SOLVABLE_SOURCENAME,
+		     source);
+    repo_internalize(repo);
+    fail_if(pool_str2id(pool, source, 0));
+
+    int nstrings = pool->ss.nstrings;
+    sack_source_index(sack);
+    fail_unless(pool->ss.nstrings == nstrings);
+
+    HyQuery q = hy_query_create(sack);
+    hy_query_filter(q, HY_PKG_SOURCERPM, HY_EQ, source);
+    fail_unless(size_and_free(q) == 1);
+    hy_sack_free(sack);
+}
+END_TEST
+
 START_TEST(test_filter_description)
 {
     HyQuery q = hy_query_create(test_globals.sack);
@@ -825,6 +1036,20 @@ START_TEST(test_filter_obsoletes)
     hy_query_filter_package_in(q, HY_PKG_OBSOLETES, HY_EQ, pset);
     fail_unless(query_count_results(q) == 1);
 
+    // every package, obsoleted or not
+    hy_packageset_free(pset);
+    hy_query_clear(q);
+    HyQuery all = hy_query_create(sack);
+    pset = hy_query_run_set(all);
+    hy_query_free(all);
+    hy_query_filter_package_in(q, HY_PKG_OBSOLETES, HY_EQ, pset);
+    fail_unless(query_count_results(q) == 1);
+
+    hy_query_clear(q);
+    hy_query_filter(q, HY_PKG_REPONAME, HY_NEQ, "updates");
+    hy_query_filter_package_in(q, HY_PKG_OBSOLETES, HY_EQ, pset);
+    fail_unless(query_count_results(q) == 0);
+
     hy_query_free(q);
     hy_packageset_free(pset);
 }
@@ -878,6 +1103,36 @@ START_TEST(test_excluded)
 }
 END_TEST
 
+START_TEST(test_cached_result)
+{
+    HySack sack = test_globals.sack;
+    HyQuery q;
+    int count;
+
+    q = hy_query_create(sack);
+    hy_query_filter(q, HY_PKG_ARCH, HY_EQ, "noarch");
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB, "p*");
+    count = query_count_results(q);
+    fail_unless(count > 0);
+    hy_query_free(q);
+
+    // same filters in a different order
+    q = hy_query_create(sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB, "p*");
+    hy_query_filter(q, HY_PKG_ARCH, HY_EQ, "noarch");
+    fail_unless(query_count_results(q) == count);
+    hy_query_free(q);
+
+    // changing the sack invalidates the cached result
+    hy_sack_repo_enabled(sack, "main", 0);
+    q = hy_query_create(sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB, "p*");
+    hy_query_filter(q, HY_PKG_ARCH, HY_EQ, "noarch");
+    fail_unless(query_count_results(q) < count);
+    hy_query_free(q);
+}
+END_TEST
+
 START_TEST(test_disabled_repo)
 {
     HySack sack = test_globals.sack;
@@ -991,6 +1246,31 @@ START_TEST(test_query_apply)
 }
 END_TEST
 
+START_TEST(test_query_apply_order)
+{
+    HyQuery q;
+
+    // the expensive filters come first, the result must not depend on that
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_SUMMARY, HY_SUBSTR, "eyes");
+    hy_query_filter(q, HY_PKG_VERSION, HY_GT, "1");
+    hy_query_filter(q, HY_PKG_NAME, HY_EQ, "penny");
+    fail_unless(size_and_free(q) == 1);
+
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_NAME, HY_NEQ, "penny-lib");
+    hy_query_filter(q, HY_PKG_NAME, HY_GLOB, "pen*");
+    fail_unless(size_and_free(q) == 1);
+
+    // stops once the result is empty
+    q = hy_query_create(test_globals.sack);
+    hy_query_filter(q, HY_PKG_RELEASE, HY_GT, "0");
+    hy_query_filter_empty(q);
+    hy_query_filter_latest(q, 1);
+    fail_unless(size_and_free(q) == 0);
+}
+END_TEST
+
 START_TEST(test_difference)
 {
     HyQuery q1 = hy_query_create(test_globals.sack);
@@ -1049,8 +1329,11 @@ query_suite(void)
     tcase_add_unchecked_fixture(tc, fixture_system_only, teardown);
     tcase_add_test(tc, test_query_sanity);
     tcase_add_test(tc, test_query_run_set_sanity);
+    tcase_add_test(tc, test_query_count);
     tcase_add_test(tc, test_query_clear);
     tcase_add_test(tc, test_query_clone);
+    tcase_add_test(tc, test_query_name_arch_in);
+    tcase_add_test(tc, test_query_glob_prefix);
     tcase_add_test(tc, test_query_empty);
     tcase_add_test(tc, test_query_repo);
     tcase_add_test(tc, test_query_name);
@@ -1070,6 +1353,8 @@ query_suite(void)
     tcase_add_test(tc, test_query_nevra_glob);
     tcase_add_test(tc, test_query_multiple_flags);
     tcase_add_test(tc, test_query_apply);
+    tcase_add_test(tc, test_query_apply_order);
+    tcase_add_test(tc, test_filter_sourcerpm_uninterned);
     suite_add_tcase(s, tc);
 
     tc = tcase_create("Updates");
@@ -1104,6 +1389,9 @@ query_suite(void)
     tcase_add_unchecked_fixture(tc, fixture_all, teardown);
     tcase_add_test(tc, test_filter_latest2);
     tcase_add_test(tc, test_filter_latest_archs);
+    tcase_add_test(tc, test_filter_latest_all);
+    tcase_add_test(tc, test_query_text_index);
+    tcase_add_test(tc, test_query_requires_all);
     tcase_add_test(tc, test_filter_obsoletes);
     tcase_add_test(tc, test_filter_reponames);
     suite_add_tcase(s, tc);
@@ -1121,6 +1409,7 @@ query_suite(void)
     tcase_add_checked_fixture(tc, fixture_reset, NULL);
     tcase_add_test(tc, test_excluded);
     tcase_add_test(tc, test_disabled_repo);
+    tcase_add_test(tc, test_cached_result);
     suite_add_tcase(s, tc);
 
     tc = tcase_create("Set Operations");
@@ -22,9 +22,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 // libsolv
+#include <solv/repo_write.h>
 #include <solv/testcase.h>
 
 // hawkey
@@ -58,6 +60,43 @@ START_TEST(test_sack_create)
 }
 END_TEST
 
+START_TEST(test_evr_split)
+{
+    HySack sack = hy_sack_create(test_globals.tmpdir, NULL, NULL, NULL,
+				 HY_MAKE_CACHE_DIR);
+    Pool *pool = sack_pool(sack);
+    const struct _EvrSplit *split;
+
+    const char *evr = "3:1.2-4.fc20";
+    split = sack_evr_split(sack, pool_str2id(pool, evr, 1));
+    fail_unless(split->epoch == 3);
+    fail_unless(split->version == 2 && split->version_len == 3);
+    ck_assert_str_eq(evr + split->release, "4.fc20");
+
+    evr = "1.2";
+    split = sack_evr_split(sack, pool_str2id(pool, evr, 1));
+    fail_unless(split->epoch == 0);
+    fail_unless(split->version == 0 && split->version_len == 3);
+    ck_assert_str_eq(evr + split->release, "");
+
+    // the table grows, nothing is interned
+    int nstrings = pool->ss.nstrings;
+    for (int i = 0; i < 1000; ++i) {
+	char buf[32];
+	sprintf(buf, "%d.0-1", i);
+	Id id = pool_str2id(pool, buf, 1);
+	nstrings = pool->ss.nstrings;
+	split = sack_evr_split(sack, id);
+	fail_unless(split->evr == id);
+	fail_unless(split->version_len == (int)strlen(buf) - 2);
+    }
+    fail_unless(pool->ss.nstrings == nstrings);
+    split = sack_evr_split(sack, pool_str2id(pool, "3:1.2-4.fc20", 0));
+    fail_unless(split->epoch == 3 && split->version_len == 3);
+    hy_sack_free(sack);
+}
+END_TEST
+
 START_TEST(test_give_cache_fn)
 {
     HySack sack = hy_sack_create(test_globals.tmpdir, NULL, NULL, NULL,
@@ -123,6 +162,51 @@ START_TEST(test_repo_written)
 }
 END_TEST
 
+static void
+load_repos_twice(HySack sack, int nthreads)
+{
+    Pool *pool = sack_pool(sack);
+    const char *repo_path = pool_tmpjoin(pool, test_globals.repo_dir,
+					 YUM_DIR_SUFFIX, NULL);
+    HyRepo repos[] = {
+	glob_for_repofiles(pool, "test_load_repos_1", repo_path),
+	glob_for_repofiles(pool, "test_load_repos_2", repo_path)
+    };
+
+    fail_if(hy_sack_load_repos(sack, repos, 2,
+			       HY_BUILD_CACHE | HY_LOAD_FILELISTS |
+			       HY_LOAD_PRESTO, nthreads));
+    hy_repo_free(repos[0]);
+    hy_repo_free(repos[1]);
+}
+
+START_TEST(test_load_repos)
+{
+    HySack sack = hy_sack_create(test_globals.tmpdir, NULL, NULL, NULL,
+				 HY_MAKE_CACHE_DIR);
+    load_repos_twice(sack, 2);
+    fail_unless(hy_sack_count(sack) == 2 * TEST_EXPECT_YUM_NSOLVABLES);
+
+    HyRepo repo1 = hrepo_by_name(sack, "test_load_repos_1");
+    HyRepo repo2 = hrepo_by_name(sack, "test_load_repos_2");
+    // in the given order, not in the order the threads finished
+    fail_unless(repo1->libsolv_repo->repoid < repo2->libsolv_repo->repoid);
+    fail_unless(repo1->state_main == _HY_WRITTEN);
+    fail_unless(repo2->state_filelists == _HY_WRITTEN);
+    fail_unless(repo2->state_presto == _HY_WRITTEN);
+    hy_sack_free(sack);
+
+    sack = hy_sack_create(test_globals.tmpdir, NULL, NULL, NULL,
+			  HY_MAKE_CACHE_DIR);
+    load_repos_twice(sack, 2);
+    repo2 = hrepo_by_name(sack, "test_load_repos_2");
+    fail_unless(repo2->state_main == _HY_LOADED_CACHE);
+    fail_unless(repo2->state_filelists == _HY_LOADED_CACHE);
+    fail_unless(hy_sack_count(sack) == 2 * TEST_EXPECT_YUM_NSOLVABLES);
+    hy_sack_free(sack);
+}
+END_TEST
+
 START_TEST(test_repo_load)
 {
     fail_unless(hy_sack_count(test_globals.sack) ==
@@ -159,6 +243,299 @@ check_filelist(Pool *pool)
     dataiterator_free(&di);
 }
 
+START_TEST(test_load_pipelined)
+{
+    HySack sack = hy_sack_create(test_globals.tmpdir, NULL, NULL, NULL,
+				 HY_MAKE_CACHE_DIR);
+    Pool *pool = sack_pool(sack);
+    const char *repo_path = pool_tmpjoin(pool, test_globals.repo_dir,
+					 YUM_DIR_SUFFIX, NULL);
+    HyRepo repo = glob_for_repofiles(pool, "test_load_pipelined", repo_path);
+
+    fail_if(hy_sack_load_repo(sack, repo,
+			      HY_LOAD_FILELISTS | HY_LOAD_PIPELINED));
+    fail_unless(hy_sack_count(sack) == TEST_EXPECT_YUM_NSOLVABLES);
+    check_filelist(pool);
+    fail_unless(hy_repo_get_load_time(repo, HY_REPO_TIME_DECOMPRESS) > 0);
+    fail_unless(hy_repo_get_load_time(repo, HY_REPO_TIME_PARSE) > 0);
+    hy_repo_free(repo);
+    hy_sack_free(sack);
+}
+END_TEST
+
+struct _FakeHeader {
+    Id rpmdbid;
+    const char *name;
+    const char *evr;
+    const char *arch;
+};
+
+static const struct _FakeHeader fake_rpmdb[] = {
+    {1, "fool", "1-5", "x86_64"},
+    {2, "penny", "4-1", "noarch"},
+    {3, "walrus", "2-6", "noarch"},
+    {4, "gpg-pubkey", "9f3b-52ab", "(none)"},
+    {5, "flying", "3-0", "noarch"}
+};
+#define FAKE_GPG_KEY 4
+
+/* adds the header the way repo_add_rpm_handle() would, counts the reads */
+static Id
+fake_add_header(Repo *repo, Id rpmdbid, void *data, int flags)
+{
+    Pool *pool = repo->pool;
+    int *nread = data;
+
+    for (unsigned i = 0; i < sizeof(fake_rpmdb) / sizeof(*fake_rpmdb); ++i) {
+	const struct _FakeHeader *h = fake_rpmdb + i;
+	if (h->rpmdbid != rpmdbid)
+	    continue;
+
+	Id p = repo_add_solvable(repo);
+	Solvable *s = pool_id2solvable(pool, p);
+	s->name = pool_str2id(pool, h->name, 1);
+	s->evr = pool_str2id(pool, h->evr, 1);
+	s->arch = pool_str2id(pool, h->arch, 1);
+	s->provides = repo_addid_dep(repo, s->provides,
+				     pool_rel2id(pool, s->name, s->evr,
+						 REL_EQ, 1), 0);
+	repo_set_str(repo, p, SOLVABLE_SUMMARY, h->name);
+	if (!(flags & REPO_NO_INTERNALIZE))
+	    repo_internalize(repo);
+	(*nread)++;
+	return p;
+    }
+    return 0;
+}
+
+/* what a full repo_add_rpmdb() makes of the headers */
+static void
+fake_full_load(Repo *repo, const Id *rpmdbids, int n, int with_rpmdbids)
+{
+    int nread = 0;
+
+    for (int i = 0; i < n; ++i) {
+	if (rpmdbids[i] == FAKE_GPG_KEY)
+	    continue;
+	Id p = fake_add_header(repo, rpmdbids[i], &nread, REPO_NO_INTERNALIZE);
+	if (with_rpmdbids)
+	    repo_set_num(repo, p, RPM_RPMDBID, rpmdbids[i]);
+    }
+    repo_internalize(repo);
+}
+
+static char *
+write_rpmdb_cache(Pool *pool, const Id *rpmdbids, int n, int with_rpmdbids)
+{
+    char *fn = solv_dupjoin(test_globals.tmpdir, "/rpmdb_cache.solv", NULL);
+    Repo *repo = repo_create(pool, "cache");
+    FILE *fp = fopen(fn, "w");
+
+    fake_full_load(repo, rpmdbids, n, with_rpmdbids);
+    fail_if(repo_write(repo, fp));
+    fclose(fp);
+    repo_free(repo, 1);
+    return fn;
+}
+
+/* "rpmdbid nevra summary" lines, by rpmdbid */
+static char *
+dump_rpmdb_repo(Repo *repo)
+{
+    Pool *pool = repo->pool;
+    char *out = solv_strdup("");
+    char buf[16];
+
+    for (Id rpmdbid = 1; rpmdbid <= FAKE_GPG_KEY + 1; ++rpmdbid) {
+	Id p;
+	Solvable *s;
+
+	FOR_REPO_SOLVABLES(repo, p, s) {
+	    if (repo->rpmdbid[p - repo->start] != rpmdbid)
+		continue;
+	    sprintf(buf, "%d ", rpmdbid);
+	    out = solv_dupappend(out, buf, pool_solvable2str(pool, s));
+	    out = solv_dupappend(out, " ",
+				 solvable_lookup_str(s, SOLVABLE_SUMMARY));
+	    out = solv_dupappend(out, "\n", NULL);
+	}
+    }
+    return out;
+}
+
+START_TEST(test_rpmdb_cache_update)
+{
+    Pool *pool = pool_create();
+    const Id cached[] = {1, 2, 3};
+    const Id current[] = {5, 4, 3, 1};
+    char *fn = write_rpmdb_cache(pool, cached, 3, 1);
+    Repo *repo = repo_create(pool, HY_SYSTEM_REPO_NAME);
+    Queue rpmdbids, skip;
+    int nread = 0, nadded, nremoved;
+
+    queue_init(&rpmdbids);
+    queue_insertn(&rpmdbids, 0, 4, current);
+    queue_init(&skip);
+    queue_push(&skip, FAKE_GPG_KEY);
+    FILE *fp = fopen(fn, "r");
+    fail_if(rpmdb_cache_update(repo, fp, &rpmdbids, &skip, fake_add_header,
+			       &nread, REPO_REUSE_REPODATA,
+			       &nadded, &nremoved));
+    fclose(fp);
+    // penny is gone, only flying was read, the key was not
+    fail_unless(nadded == 1 && nremoved == 1 && nread == 1);
+    fail_unless(repo->nsolvables == 3);
+
+    Repo *full = repo_create(pool, "full");
+    fake_full_load(full, current, 4, 1);
+    char *dump = dump_rpmdb_repo(repo), *dump_full = dump_rpmdb_repo(full);
+    ck_assert_str_eq(dump, dump_full);
+    ck_assert_str_eq(dump, "1 fool-1-5.x86_64 fool\n"
+		     "3 walrus-2-6.noarch walrus\n"
+		     "5 flying-3-0.noarch flying\n");
+
+    solv_free(dump);
+    solv_free(dump_full);
+    queue_free(&rpmdbids);
+    queue_free(&skip);
+    solv_free(fn);
+    pool_free(pool);
+}
+END_TEST
+
+START_TEST(test_rpmdb_cache_update_fallback)
+{
+    Pool *pool = pool_create();
+    const Id cached[] = {1, 2, 3};
+    const Id current[] = {1, 3};
+    Repo *repo = repo_create(pool, HY_SYSTEM_REPO_NAME);
+    Queue rpmdbids, skip;
+    int nread = 0, nadded, nremoved;
+    struct stat st;
+
+    queue_init(&rpmdbids);
+    queue_insertn(&rpmdbids, 0, 2, current);
+    queue_init(&skip);
+
+    // truncated
+    char *fn = write_rpmdb_cache(pool, cached, 3, 1);
+    fail_if(stat(fn, &st) || truncate(fn, st.st_size / 2));
+    FILE *fp = fopen(fn, "r");
+    fail_unless(rpmdb_cache_update(repo, fp, &rpmdbids, &skip,
+				   fake_add_header, &nread, 0,
+				   &nadded, &nremoved));
+    fclose(fp);
+    fail_unless(repo->nsolvables == 0 && nread == 0);
+    solv_free(fn);
+
+    // written without the rpmdbids
+    fn = write_rpmdb_cache(pool, cached, 3, 0);
+    fp = fopen(fn, "r");
+    fail_unless(rpmdb_cache_update(repo, fp, &rpmdbids, &skip,
+				   fake_add_header, &nread, 0,
+				   &nadded, &nremoved));
+    fclose(fp);
+    fail_unless(repo->nsolvables == 0 && nread == 0);
+
+    // the emptied repo takes the full load
+    fake_full_load(repo, current, 2, 1);
+    char *dump = dump_rpmdb_repo(repo);
+    ck_assert_str_eq(dump, "1 fool-1-5.x86_64 fool\n"
+		     "3 walrus-2-6.noarch walrus\n");
+
+    solv_free(dump);
+    queue_free(&rpmdbids);
+    queue_free(&skip);
+    solv_free(fn);
+    pool_free(pool);
+}
+END_TEST
+
+START_TEST(test_refresh)
+{
+    HySack sack = hy_sack_create(test_globals.tmpdir, NULL, NULL, NULL,
+				 HY_MAKE_CACHE_DIR);
+    Pool *pool = sack_pool(sack);
+    const char *repo_path = pool_tmpjoin(pool, test_globals.repo_dir,
+					 YUM_DIR_SUFFIX, NULL);
+    HyRepo repo = glob_for_repofiles(pool, "test_refresh", repo_path);
+    HyRepo same = glob_for_repofiles(pool, "test_refresh", repo_path);
+    HyRepo changed = glob_for_repofiles(pool, "test_refresh", repo_path);
+
+    fail_if(hy_sack_load_repo(sack, repo, HY_LOAD_FILELISTS));
+    fail_if(hy_sack_refresh(sack, &same, 1, HY_LOAD_FILELISTS));
+    fail_unless(hrepo_by_name(sack, "test_refresh") == repo);
+    fail_unless(same->state_main == _HY_NEW);
+
+    // a repomd.xml that differs only in the trailing whitespace
+    char *fn = solv_dupjoin(test_globals.tmpdir, "/test_refresh.xml", NULL);
+    char *content = read_whole_file(hy_repo_get_string(repo, HY_REPO_MD_FN));
+    FILE *fp = fopen(fn, "w");
+    fprintf(fp, "%s\n", content);
+    fclose(fp);
+    hy_repo_set_string(changed, HY_REPO_MD_FN, fn);
+    hy_sack_repo_enabled(sack, "test_refresh", 0);
+
+    fail_if(hy_sack_refresh(sack, &changed, 1, HY_LOAD_FILELISTS));
+    fail_unless(hrepo_by_name(sack, "test_refresh") == changed);
+    fail_unless(repo->libsolv_repo == NULL);
+    fail_unless(repo->state_main == _HY_NEW);
+    fail_unless(hy_sack_count(sack) == TEST_EXPECT_YUM_NSOLVABLES);
+    fail_unless(changed->libsolv_repo->disabled);
+    check_filelist(pool);
+
+    HyRepo cmdline = hy_repo_create(HY_CMDLINE_REPO_NAME);
+    hy_sack_create_cmdline_repo(sack);
+    fail_unless(hy_sack_refresh(sack, &cmdline, 1, 0) == HY_E_FAILED);
+    fail_unless(hy_get_errno() == HY_E_OP);
+
+    hy_repo_free(cmdline);
+    solv_free(content);
+    solv_free(fn);
+    hy_repo_free(changed);
+    hy_repo_free(same);
+    hy_repo_free(repo);
+    hy_sack_free(sack);
+}
+END_TEST
+
+START_TEST(test_refresh_unreadable)
+{
+    HySack sack = hy_sack_create(test_globals.tmpdir, NULL, NULL, NULL,
+				 HY_MAKE_CACHE_DIR);
+    Pool *pool = sack_pool(sack);
+    const char *repo_path = pool_tmpjoin(pool, test_globals.repo_dir,
+					 YUM_DIR_SUFFIX, NULL);
+    HyRepo repo = glob_for_repofiles(pool, "test_refresh", repo_path);
+    HyRepo fresh = hy_repo_create("test_refresh");
+
+    // no repomd.xml set at all: nothing gets loaded
+    fail_unless(hy_sack_refresh(sack, &fresh, 1, 0) == HY_E_FAILED);
+    fail_unless(hy_get_errno() == HY_E_IO);
+    fail_unless(repo_by_name(sack, "test_refresh") == NULL);
+
+    fail_if(hy_sack_load_repo(sack, repo, HY_LOAD_FILELISTS));
+    int count = hy_sack_count(sack);
+
+    // missing and unreadable repomd.xml: the loaded repo stays
+    const char *fns[] = {"/no/such/repomd.xml", test_globals.tmpdir};
+    for (int i = 0; i < 2; ++i) {
+	hy_repo_set_string(fresh, HY_REPO_MD_FN, fns[i]);
+	fail_unless(hy_sack_refresh(sack, &fresh, 1, 0) == HY_E_FAILED);
+	fail_unless(hy_get_errno() == HY_E_IO);
+	fail_unless(hrepo_by_name(sack, "test_refresh") == repo);
+	fail_unless(repo->state_main != _HY_NEW);
+	fail_unless(fresh->state_main == _HY_NEW);
+	fail_unless(hy_sack_count(sack) == count);
+    }
+    check_filelist(pool);
+
+    hy_repo_free(fresh);
+    hy_repo_free(repo);
+    hy_sack_free(sack);
+}
+END_TEST
+
 START_TEST(test_filelist)
 {
     HySack sack = test_globals.sack;
@@ -269,10 +646,17 @@ sack_suite(void)
     TCase *tc = tcase_create("Core");
     tcase_add_test(tc, test_environment);
     tcase_add_test(tc, test_sack_create);
+    tcase_add_test(tc, test_evr_split);
     tcase_add_test(tc, test_give_cache_fn);
     tcase_add_test(tc, test_list_arches);
     tcase_add_test(tc, test_load_repo_err);
     tcase_add_test(tc, test_repo_written);
+    tcase_add_test(tc, test_load_repos);
+    tcase_add_test(tc, test_load_pipelined);
+    tcase_add_test(tc, test_refresh);
+    tcase_add_test(tc, test_refresh_unreadable);
+    tcase_add_test(tc, test_rpmdb_cache_update);
+    tcase_add_test(tc, test_rpmdb_cache_update_fallback);
     suite_add_tcase(s, tc);
 
     tc = tcase_create("Repos");
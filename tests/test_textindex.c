@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <check.h>
+#include <stdio.h>
+
+// libsolv
+#include <solv/pool.h>
+#include <solv/util.h>
+
+// hawkey
+#include "src/iutil.h"
+#include "src/sack_internal.h"
+#include "src/textindex.h"
+#include "fixtures.h"
+#include "test_suites.h"
+
+static struct _TextIndex *
+build_system_index(Repo **repop)
+{
+    Repo *repo = repo_by_name(test_globals.sack, HY_SYSTEM_REPO_NAME);
+    fail_if(repo == NULL);
+    *repop = repo;
+    return textindex_build(repo, repo->end - repo->start);
+}
+
+static const char *
+candidate_name(Repo *repo, Queue *offsets, int i)
+{
+    Pool *pool = repo->pool;
+    return pool_id2str(pool, pool->solvables[repo->start +
+					     offsets->elements[i]].name);
+}
+
+START_TEST(test_candidates)
+{
+    Repo *repo;
+    struct _TextIndex *idx = build_system_index(&repo);
+    Queue offsets;
+
+    queue_init(&offsets);
+    fail_if(textindex_candidates(idx, "ears", &offsets));
+    fail_unless(offsets.count == 1);
+    ck_assert_str_eq(candidate_name(repo, &offsets, 0), "penny-lib");
+
+    // the index is case insensitive
+    fail_if(textindex_candidates(idx, "In My EYES", &offsets));
+    fail_unless(offsets.count == 1);
+    ck_assert_str_eq(candidate_name(repo, &offsets, 0), "penny");
+
+    fail_if(textindex_candidates(idx, "in my", &offsets));
+    fail_unless(offsets.count == 2);
+    fail_if(textindex_candidates(idx, "noses", &offsets));
+    fail_unless(offsets.count == 0);
+
+    // too short to be looked up
+    fail_unless(textindex_candidates(idx, "in", &offsets));
+
+    queue_free(&offsets);
+    textindex_free(idx);
+}
+END_TEST
+
+START_TEST(test_write_read)
+{
+    Repo *repo;
+    struct _TextIndex *idx = build_system_index(&repo);
+    int nsolvables = repo->end - repo->start;
+    FILE *fp = tmpfile();
+
+    fail_if(fp == NULL);
+    fail_if(textindex_write(idx, fp));
+    rewind(fp);
+    fail_unless(textindex_read(fp, nsolvables + 1) == NULL);
+    rewind(fp);
+    struct _TextIndex *idx2 = textindex_read(fp, nsolvables);
+    fail_if(idx2 == NULL);
+    fclose(fp);
+
+    fail_unless(idx2->ntrigrams == idx->ntrigrams);
+    fail_unless(idx2->start[idx2->ntrigrams] == idx->start[idx->ntrigrams]);
+
+    Queue offsets;
+    queue_init(&offsets);
+    fail_if(textindex_candidates(idx2, "ears", &offsets));
+    fail_unless(offsets.count == 1);
+    queue_free(&offsets);
+
+    textindex_free(idx2);
+    textindex_free(idx);
+}
+END_TEST
+
+START_TEST(test_read_damaged)
+{
+    Repo *repo;
+    struct _TextIndex *idx = build_system_index(&repo);
+    int nsolvables = repo->end - repo->start;
+    FILE *fp = tmpfile();
+
+    fail_if(textindex_write(idx, fp));
+    long size = ftell(fp);
+    char *data = solv_malloc(size);
+    rewind(fp);
+    fail_unless(fread(data, size, 1, fp) == 1);
+    fclose(fp);
+
+    // truncated
+    fp = tmpfile();
+    fwrite(data, size - 1, 1, fp);
+    rewind(fp);
+    fail_unless(textindex_read(fp, nsolvables) == NULL);
+    fclose(fp);
+
+    // counts far beyond the file size are not allocated
+    uint32_t *header = (uint32_t *)(data + 4);
+    for (int i = 2; i < 4; ++i) {
+	uint32_t saved = header[i];
+	header[i] = UINT32_MAX - 1;
+	fp = tmpfile();
+	fwrite(data, size, 1, fp);
+	rewind(fp);
+	fail_unless(textindex_read(fp, nsolvables) == NULL);
+	fclose(fp);
+	header[i] = saved;
+    }
+
+    // postings out of the repo
+    uint32_t *postings = (uint32_t *)(data + size) - 1;
+    *postings = nsolvables;
+    fp = tmpfile();
+    fwrite(data, size, 1, fp);
+    rewind(fp);
+    fail_unless(textindex_read(fp, nsolvables) == NULL);
+    fclose(fp);
+
+    solv_free(data);
+    textindex_free(idx);
+}
+END_TEST
+
+Suite *
+textindex_suite(void)
+{
+    Suite *s = suite_create("TextIndex");
+    TCase *tc = tcase_create("Core");
+    tcase_add_unchecked_fixture(tc, fixture_system_only, teardown);
+    tcase_add_test(tc, test_candidates);
+    tcase_add_test(tc, test_write_read);
+    tcase_add_test(tc, test_read_damaged);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
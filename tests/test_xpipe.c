@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+
+// libsolv
+#include <solv/pool.h>
+#include <solv/solv_xfopen.h>
+
+// hawkey
+#include "src/repo_internal.h"
+#include "src/xpipe.h"
+#include "fixtures.h"
+#include "testsys.h"
+#include "test_suites.h"
+
+static void
+assert_same_content(FILE *fp1, FILE *fp2)
+{
+    char buf1[1000], buf2[1000];
+    size_t len1, len2;
+
+    // odd sizes so the reads straddle the pipe's buffers
+    do {
+	len1 = fread(buf1, 1, sizeof(buf1) - 3, fp1);
+	len2 = fread(buf2, 1, sizeof(buf2) - 3, fp2);
+	fail_unless(len1 == len2);
+	fail_if(memcmp(buf1, buf2, len1));
+    } while (len1);
+    fail_unless(feof(fp1) && feof(fp2));
+}
+
+START_TEST(test_compressed)
+{
+    Pool *pool = pool_create();
+    const char *repo_path = pool_tmpjoin(pool, test_globals.repo_dir,
+					 YUM_DIR_SUFFIX, NULL);
+    HyRepo repo = glob_for_repofiles(pool, "test_xpipe", repo_path);
+    const char *fn = hy_repo_get_string(repo, HY_REPO_PRIMARY_FN);
+    struct _XPipeTimes times;
+
+    memset(&times, 0, sizeof(times));
+    FILE *fp1 = xpipe_open(fn, &times);
+    FILE *fp2 = solv_xfopen(fn, "r");
+    fail_if(fp1 == NULL || fp2 == NULL);
+    assert_same_content(fp1, fp2);
+    fclose(fp1);
+    fclose(fp2);
+    fail_unless(times.decompress > 0);
+    fail_unless(times.parse >= 0 && times.parse_stall >= 0);
+
+    fail_unless(xpipe_open("/non/existing", &times) == NULL);
+    hy_repo_free(repo);
+    pool_free(pool);
+}
+END_TEST
+
+START_TEST(test_many_buffers)
+{
+    char *fn = solv_dupjoin(test_globals.tmpdir, "/test_xpipe.txt", NULL);
+    FILE *fp = fopen(fn, "w");
+
+    for (int i = 0; i < 200000; ++i)
+	fprintf(fp, "line %d\n", i);
+    fclose(fp);
+
+    FILE *fp1 = xpipe_open(fn, NULL);
+    FILE *fp2 = fopen(fn, "r");
+    assert_same_content(fp1, fp2);
+    fclose(fp1);
+    fclose(fp2);
+
+    // closing before the end stops the decompression
+    fp1 = xpipe_open(fn, NULL);
+    fail_unless(fgetc(fp1) == 'l');
+    fclose(fp1);
+    solv_free(fn);
+}
+END_TEST
+
+Suite *
+xpipe_suite(void)
+{
+    Suite *s = suite_create("XPipe");
+    TCase *tc = tcase_create("Core");
+    tcase_add_test(tc, test_compressed);
+    tcase_add_test(tc, test_many_buffers);
+    suite_add_tcase(s, tc);
+
+    return s;
+}